@@ -0,0 +1,76 @@
+#include "alloc_stats.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <atomic>
+#include <new>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace {
+  std::atomic<size_t> live_counter(0);
+  std::atomic<size_t> peak_counter(0);
+  std::atomic<size_t> allocation_counter(0);
+  std::atomic<size_t> usable_counter(0);
+
+  // Every block starts with its size, padded to keep the alignment of malloc
+  const size_t HEADER = alignof(max_align_t);
+
+  size_t usable_size(void * block, size_t size) {
+#ifdef __GLIBC__
+    return malloc_usable_size(block) - HEADER;
+#else
+    (void)block;
+    return size;
+#endif
+  }
+
+  void * allocate(size_t size) {
+    void * block = malloc(size + HEADER);
+    if (!block) return nullptr;
+    *static_cast<size_t *>(block) = size;
+    size_t live = live_counter.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = peak_counter.load(std::memory_order_relaxed);
+    while (live > peak && !peak_counter.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    allocation_counter.fetch_add(1, std::memory_order_relaxed);
+    usable_counter.fetch_add(usable_size(block, size), std::memory_order_relaxed);
+    return static_cast<char *>(block) + HEADER;
+  }
+
+  void deallocate(void * p) {
+    if (!p) return;
+    void * block = static_cast<char *>(p) - HEADER;
+    size_t size = *static_cast<size_t *>(block);
+    live_counter.fetch_sub(size, std::memory_order_relaxed);
+    usable_counter.fetch_sub(usable_size(block, size), std::memory_order_relaxed);
+    free(block);
+  }
+
+  void * allocate_or_throw(size_t size) {
+    void * p = allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+  }
+}
+
+alloc_stats alloc_stats::current() {
+  alloc_stats stats;
+  stats.live_bytes = live_counter.load(std::memory_order_relaxed);
+  stats.peak_bytes = peak_counter.load(std::memory_order_relaxed);
+  stats.allocations = allocation_counter.load(std::memory_order_relaxed);
+  stats.usable_bytes = usable_counter.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void alloc_stats::reset_peak() {
+  peak_counter.store(live_counter.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void * operator new(size_t size) { return allocate_or_throw(size); }
+void * operator new[](size_t size) { return allocate_or_throw(size); }
+void * operator new(size_t size, std::nothrow_t const &) noexcept { return allocate(size); }
+void * operator new[](size_t size, std::nothrow_t const &) noexcept { return allocate(size); }
+void operator delete(void * p) noexcept { deallocate(p); }
+void operator delete[](void * p) noexcept { deallocate(p); }
+void operator delete(void * p, std::nothrow_t const &) noexcept { deallocate(p); }
+void operator delete[](void * p, std::nothrow_t const &) noexcept { deallocate(p); }
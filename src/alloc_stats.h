@@ -0,0 +1,23 @@
+#pragma once
+#include <stddef.h>
+
+/*
+ * Heap usage of the whole program, counted by the global operator new and
+ * delete replacements in alloc_stats.cpp
+ */
+struct alloc_stats {
+  // Snapshot of the counters
+  static alloc_stats current();
+  // Starts tracking a new peak from the current live bytes
+  static void reset_peak();
+
+  // Bytes requested and not freed yet
+  size_t live_bytes;
+  // Highest `live_bytes` since the last `reset_peak`
+  size_t peak_bytes;
+  // Number of allocations since the start of the program
+  size_t allocations;
+  // Bytes the allocator actually reserved for the live blocks, which shows
+  // its rounding overhead (same as `live_bytes` where it can't be known)
+  size_t usable_bytes;
+};
@@ -0,0 +1,734 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include "vector.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace gtl {
+  /*
+   * An adaptive radix tree (Leis et al., "The Adaptive Radix Tree: ARTful
+   * Indexing for Main-Memory Databases") for integer keys
+   *
+   * A key is split into bytes, most significant first (with the sign bit
+   * flipped, so that byte order is the key order), and every inner node
+   * branches on one byte. Inner nodes grow and shrink between 4, 16, 48 and
+   * 256 children. A chain of single-child nodes is compressed into a prefix
+   * of the next node, and a leaf is stored as soon as its key is unique, so a
+   * lookup visits at most `sizeof(K)` inner nodes without comparing keys
+   * until the leaf.
+   */
+  template <typename K, typename V> struct art_map {
+    art_map();
+    ~art_map();
+
+    art_map(art_map &&other) = delete;
+    art_map &operator=(art_map other) = delete;
+
+    size_t size() const;
+    size_t capacity() const;
+
+    bool add(K const & key, V const & value);
+    bool remove(K const & key);
+
+    V const* lookup(K const &key) const;
+    V * lookup(K const &key);
+
+    bool contains_key(K const &key) const;
+
+    // Calls `f(key, value)` for every element in the key order
+    template <typename F> void for_each(F f) const;
+    // Calls `f(key, value)` for every element with `from <= key <= to` in the key order
+    template <typename F> void for_each_in_range(K const & from, K const & to, F f) const;
+
+    /*
+     * Removes the elements for which `pred(key, value)` is true in one ordered
+     * pass over the tree. An inner node which lost children is rebuilt once,
+     * at the size of the children left. Returns the number of removed
+     * elements.
+     */
+    template <typename P> size_t erase_if(P pred);
+    // Adds the `n` pairs like `add` in order
+    size_t insert(std::pair<K, V> const * pairs, size_t n);
+    // Adds every element of `other`, its values replace those of equal keys
+    size_t merge(art_map const & other);
+
+  private:
+    static_assert(std::is_integral<K>::value && sizeof(K) <= 8, "Keys are integers of up to 8 bytes");
+    static const size_t KEY_BYTES = sizeof(K);
+
+    enum node_type { LEAF, NODE4, NODE16, NODE48, NODE256 };
+
+    struct node {
+      uint8_t type;
+    };
+
+    struct leaf : node {
+      K key;
+      V value;
+    };
+
+    struct inner : node {
+      uint8_t prefix_length;
+      uint16_t count;
+      uint8_t prefix[KEY_BYTES];
+    };
+
+    // Children sorted by their key byte
+    struct node4 : inner {
+      static const uint8_t TYPE = NODE4;
+      uint8_t keys[4];
+      node * children[4];
+    };
+
+    struct node16 : inner {
+      static const uint8_t TYPE = NODE16;
+      uint8_t keys[16];
+      node * children[16];
+    };
+
+    // `index[byte]` is one past the child slot, 0 if there is no child
+    struct node48 : inner {
+      static const uint8_t TYPE = NODE48;
+      uint8_t index[256];
+      node * children[48];
+    };
+
+    struct node256 : inner {
+      static const uint8_t TYPE = NODE256;
+      node * children[256];
+    };
+
+    static uint64_t key_bits(K key);
+    static uint8_t key_byte(uint64_t bits, size_t depth);
+
+    static leaf * new_leaf(K const & key, V const & value);
+    template <typename N> static N * new_inner(inner const * header);
+    static void destroy(node * n);
+    // Deletes `n` without its children
+    static void delete_node(node * n);
+
+    static node * const * find_child(inner const * n, uint8_t byte);
+    static node ** find_child(inner * n, uint8_t byte);
+    template <typename N> static void insert_sorted(N * n, uint8_t byte, node * child);
+    static void add_child(node ** ref, inner * n, uint8_t byte, node * child);
+    static void remove_child(node ** ref, inner * n, uint8_t byte);
+    static void merge_into_child(node ** ref, inner * n, uint8_t byte, node * child);
+    template <typename N>
+    static node * rebuilt(inner const * header, uint8_t const * bytes, node * const * children, size_t count);
+    template <typename P> static size_t erase_if(node ** ref, P & pred);
+    template <typename F> static bool for_each_child(inner const * n, F f);
+
+    leaf const * find(K const & key) const;
+    template <typename F> static void for_each(node const * n, F & f);
+    template <typename F>
+    static void for_each_in_range(node const * n, size_t depth, K const & from, K const & to,
+                                  bool from_bound, bool to_bound, F & f);
+
+    node * root_;
+    size_t size_;
+  };
+
+template <typename K, typename V>
+art_map<K, V>::art_map()
+  : root_(nullptr)
+  , size_(0)
+{}
+
+template <typename K, typename V>
+art_map<K, V>::~art_map() {
+  destroy(root_);
+}
+
+template <typename K, typename V>
+size_t art_map<K, V>::size() const {
+  return size_;
+}
+
+template <typename K, typename V>
+size_t art_map<K, V>::capacity() const {
+  return size();
+}
+
+template <typename K, typename V>
+uint64_t art_map<K, V>::key_bits(K key) {
+  typedef typename std::make_unsigned<K>::type U;
+  uint64_t bits = static_cast<U>(key);
+  if (std::is_signed<K>::value) bits ^= uint64_t(1) << (8 * KEY_BYTES - 1);
+  return bits;
+}
+
+template <typename K, typename V>
+uint8_t art_map<K, V>::key_byte(uint64_t bits, size_t depth) {
+  return static_cast<uint8_t>(bits >> (8 * (KEY_BYTES - 1 - depth)));
+}
+
+template <typename K, typename V>
+auto art_map<K, V>::new_leaf(K const & key, V const & value) -> leaf * {
+  leaf * l = new leaf();
+  l->type = LEAF;
+  l->key = key;
+  l->value = value;
+  return l;
+}
+
+// A node of type `N` with the prefix of `header` (if any) and no children
+template <typename K, typename V>
+template <typename N>
+N * art_map<K, V>::new_inner(inner const * header) {
+  N * n = new N();
+  n->type = N::TYPE;
+  if (header) {
+    n->prefix_length = header->prefix_length;
+    memcpy(n->prefix, header->prefix, header->prefix_length);
+  }
+  return n;
+}
+
+template <typename K, typename V>
+void art_map<K, V>::destroy(node * n) {
+  if (!n) return;
+  if (n->type != LEAF) {
+    for_each_child(static_cast<inner *>(n), [](uint8_t, node * child) {
+      destroy(child);
+      return true;
+    });
+  }
+  delete_node(n);
+}
+
+template <typename K, typename V>
+void art_map<K, V>::delete_node(node * n) {
+  switch (n->type) {
+    case LEAF: delete static_cast<leaf *>(n); return;
+    case NODE4: delete static_cast<node4 *>(n); return;
+    case NODE16: delete static_cast<node16 *>(n); return;
+    case NODE48: delete static_cast<node48 *>(n); return;
+    case NODE256: delete static_cast<node256 *>(n); return;
+  }
+}
+
+template <typename K, typename V>
+auto art_map<K, V>::find_child(inner const * n, uint8_t byte) -> node * const * {
+  switch (n->type) {
+    case NODE4: {
+      node4 const * n4 = static_cast<node4 const *>(n);
+      for (size_t i = 0; i < n4->count; ++i) {
+        if (n4->keys[i] == byte) return &n4->children[i];
+      }
+      return nullptr;
+    }
+    case NODE16: {
+      node16 const * n16 = static_cast<node16 const *>(n);
+#ifdef __SSE2__
+      // All 16 key bytes are compared at once
+      __m128i keys = _mm_loadu_si128(reinterpret_cast<__m128i const *>(n16->keys));
+      int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(keys, _mm_set1_epi8(byte))) & ((1 << n16->count) - 1);
+      return mask ? &n16->children[__builtin_ctz(mask)] : nullptr;
+#else
+      for (size_t i = 0; i < n16->count; ++i) {
+        if (n16->keys[i] == byte) return &n16->children[i];
+      }
+      return nullptr;
+#endif
+    }
+    case NODE48: {
+      node48 const * n48 = static_cast<node48 const *>(n);
+      return n48->index[byte] ? &n48->children[n48->index[byte] - 1] : nullptr;
+    }
+    case NODE256: {
+      node256 const * n256 = static_cast<node256 const *>(n);
+      return n256->children[byte] ? &n256->children[byte] : nullptr;
+    }
+  }
+  return nullptr;
+}
+
+template <typename K, typename V>
+auto art_map<K, V>::find_child(inner * n, uint8_t byte) -> node ** {
+  return const_cast<node **>(find_child(static_cast<inner const *>(n), byte));
+}
+
+// Inserts into the sorted key and child arrays of a node4 or node16
+template <typename K, typename V>
+template <typename N>
+void art_map<K, V>::insert_sorted(N * n, uint8_t byte, node * child) {
+  size_t i = n->count;
+  while (i > 0 && n->keys[i - 1] > byte) {
+    n->keys[i] = n->keys[i - 1];
+    n->children[i] = n->children[i - 1];
+    --i;
+  }
+  n->keys[i] = byte;
+  n->children[i] = child;
+  ++n->count;
+}
+
+/*
+ * Adds a child to `n`, which `*ref` points to. A full node is replaced by the
+ * next larger one.
+ */
+template <typename K, typename V>
+void art_map<K, V>::add_child(node ** ref, inner * n, uint8_t byte, node * child) {
+  switch (n->type) {
+    case NODE4: {
+      node4 * n4 = static_cast<node4 *>(n);
+      if (n4->count < 4) {
+        insert_sorted(n4, byte, child);
+        return;
+      }
+      node16 * grown = new_inner<node16>(n4);
+      for (size_t i = 0; i < 4; ++i) {
+        insert_sorted(grown, n4->keys[i], n4->children[i]);
+      }
+      insert_sorted(grown, byte, child);
+      *ref = grown;
+      delete n4;
+      return;
+    }
+    case NODE16: {
+      node16 * n16 = static_cast<node16 *>(n);
+      if (n16->count < 16) {
+        insert_sorted(n16, byte, child);
+        return;
+      }
+      node48 * grown = new_inner<node48>(n16);
+      for (size_t i = 0; i < 16; ++i) {
+        grown->children[i] = n16->children[i];
+        grown->index[n16->keys[i]] = i + 1;
+      }
+      grown->count = 16;
+      *ref = grown;
+      delete n16;
+      add_child(ref, grown, byte, child);
+      return;
+    }
+    case NODE48: {
+      node48 * n48 = static_cast<node48 *>(n);
+      if (n48->count < 48) {
+        size_t slot = 0;
+        while (n48->children[slot]) ++slot;
+        n48->children[slot] = child;
+        n48->index[byte] = slot + 1;
+        ++n48->count;
+        return;
+      }
+      node256 * grown = new_inner<node256>(n48);
+      for (size_t b = 0; b < 256; ++b) {
+        if (n48->index[b]) grown->children[b] = n48->children[n48->index[b] - 1];
+      }
+      grown->count = 48;
+      *ref = grown;
+      delete n48;
+      add_child(ref, grown, byte, child);
+      return;
+    }
+    case NODE256: {
+      node256 * n256 = static_cast<node256 *>(n);
+      n256->children[byte] = child;
+      ++n256->count;
+      return;
+    }
+  }
+}
+
+/*
+ * Removes a child from `n`, which `*ref` points to. A node with few children
+ * left is replaced by the next smaller one, with some slack so that a node
+ * does not flip between two sizes. A node4 with a single child is merged
+ * into the child.
+ */
+template <typename K, typename V>
+void art_map<K, V>::remove_child(node ** ref, inner * n, uint8_t byte) {
+  switch (n->type) {
+    case NODE4:
+    case NODE16: {
+      uint8_t * keys = n->type == NODE4 ? static_cast<node4 *>(n)->keys : static_cast<node16 *>(n)->keys;
+      node ** children = n->type == NODE4 ? static_cast<node4 *>(n)->children : static_cast<node16 *>(n)->children;
+      size_t i = 0;
+      while (keys[i] != byte) ++i;
+      for (--n->count; i < n->count; ++i) {
+        keys[i] = keys[i + 1];
+        children[i] = children[i + 1];
+      }
+      if (n->type == NODE16 && n->count <= 3) {
+        node4 * shrunk = new_inner<node4>(n);
+        for (size_t j = 0; j < n->count; ++j) {
+          insert_sorted(shrunk, keys[j], children[j]);
+        }
+        *ref = shrunk;
+        delete static_cast<node16 *>(n);
+      } else if (n->type == NODE4 && n->count == 1) {
+        merge_into_child(ref, n, keys[0], children[0]);
+        delete static_cast<node4 *>(n);
+      }
+      return;
+    }
+    case NODE48: {
+      node48 * n48 = static_cast<node48 *>(n);
+      n48->children[n48->index[byte] - 1] = nullptr;
+      n48->index[byte] = 0;
+      if (--n48->count > 12) return;
+      node16 * shrunk = new_inner<node16>(n48);
+      for (size_t b = 0; b < 256; ++b) {
+        if (n48->index[b]) insert_sorted(shrunk, b, n48->children[n48->index[b] - 1]);
+      }
+      *ref = shrunk;
+      delete n48;
+      return;
+    }
+    case NODE256: {
+      node256 * n256 = static_cast<node256 *>(n);
+      n256->children[byte] = nullptr;
+      if (--n256->count > 40) return;
+      node48 * shrunk = new_inner<node48>(n256);
+      for (size_t b = 0; b < 256; ++b) {
+        if (!n256->children[b]) continue;
+        shrunk->children[shrunk->count] = n256->children[b];
+        shrunk->index[b] = ++shrunk->count;
+      }
+      *ref = shrunk;
+      delete n256;
+      return;
+    }
+  }
+}
+
+// Replaces `n`, which `*ref` points to, by its only child, under `byte`
+template <typename K, typename V>
+void art_map<K, V>::merge_into_child(node ** ref, inner * n, uint8_t byte, node * child) {
+  if (child->type != LEAF) {
+    // The child prefix becomes this prefix, the key byte and its own prefix
+    inner * c = static_cast<inner *>(child);
+    uint8_t prefix[KEY_BYTES];
+    size_t length = n->prefix_length;
+    memcpy(prefix, n->prefix, length);
+    prefix[length++] = byte;
+    memcpy(prefix + length, c->prefix, c->prefix_length);
+    c->prefix_length += length;
+    memcpy(c->prefix, prefix, c->prefix_length);
+  }
+  *ref = child;
+}
+
+// A node of type `N` with the prefix of `header` and the `count` children
+template <typename K, typename V>
+template <typename N>
+auto art_map<K, V>::rebuilt(inner const * header, uint8_t const * bytes, node * const * children, size_t count)
+    -> node * {
+  N * n = new_inner<N>(header);
+  node * result = n;
+  for (size_t i = 0; i < count; ++i) {
+    add_child(&result, n, bytes[i], children[i]);
+  }
+  return result;
+}
+
+// Calls `f(byte, child)` for the children in byte order while it returns true
+template <typename K, typename V>
+template <typename F>
+bool art_map<K, V>::for_each_child(inner const * n, F f) {
+  switch (n->type) {
+    case NODE4: {
+      node4 const * n4 = static_cast<node4 const *>(n);
+      for (size_t i = 0; i < n4->count; ++i) {
+        if (!f(n4->keys[i], n4->children[i])) return false;
+      }
+      return true;
+    }
+    case NODE16: {
+      node16 const * n16 = static_cast<node16 const *>(n);
+      for (size_t i = 0; i < n16->count; ++i) {
+        if (!f(n16->keys[i], n16->children[i])) return false;
+      }
+      return true;
+    }
+    case NODE48: {
+      node48 const * n48 = static_cast<node48 const *>(n);
+      for (size_t b = 0; b < 256; ++b) {
+        if (n48->index[b] && !f(b, n48->children[n48->index[b] - 1])) return false;
+      }
+      return true;
+    }
+    case NODE256: {
+      node256 const * n256 = static_cast<node256 const *>(n);
+      for (size_t b = 0; b < 256; ++b) {
+        if (n256->children[b] && !f(b, n256->children[b])) return false;
+      }
+      return true;
+    }
+  }
+  return true;
+}
+
+/*
+ * Prefixes are skipped on the way down, not compared: the key of the leaf
+ * at the end is compared instead
+ */
+template <typename K, typename V>
+auto art_map<K, V>::find(K const & key) const -> leaf const * {
+  uint64_t bits = key_bits(key);
+  node const * n = root_;
+  size_t depth = 0;
+  while (n && n->type != LEAF) {
+    inner const * i = static_cast<inner const *>(n);
+    depth += i->prefix_length;
+    node * const * child = find_child(i, key_byte(bits, depth));
+    n = child ? *child : nullptr;
+    ++depth;
+  }
+  if (!n) return nullptr;
+  leaf const * l = static_cast<leaf const *>(n);
+  return l->key == key ? l : nullptr;
+}
+
+template <typename K, typename V>
+bool art_map<K, V>::add(K const & key, V const & value) {
+  uint64_t bits = key_bits(key);
+  node ** ref = &root_;
+  size_t depth = 0;
+  while (true) {
+    node * n = *ref;
+    if (!n) {
+      *ref = new_leaf(key, value);
+      break;
+    }
+    if (n->type == LEAF) {
+      leaf * l = static_cast<leaf *>(n);
+      if (l->key == key) {
+        l->value = value;
+        return false;
+      }
+      // Both keys go under a new node4 at the first byte they differ in
+      uint64_t other = key_bits(l->key);
+      node4 * split = new_inner<node4>(nullptr);
+      while (key_byte(bits, depth) == key_byte(other, depth)) {
+        split->prefix[split->prefix_length++] = key_byte(bits, depth++);
+      }
+      insert_sorted(split, key_byte(other, depth), n);
+      insert_sorted(split, key_byte(bits, depth), new_leaf(key, value));
+      *ref = split;
+      break;
+    }
+    inner * i = static_cast<inner *>(n);
+    size_t matched = 0;
+    while (matched < i->prefix_length && i->prefix[matched] == key_byte(bits, depth + matched)) {
+      ++matched;
+    }
+    if (matched < i->prefix_length) {
+      // The key leaves the prefix: a new node4 takes the matched part
+      node4 * split = new_inner<node4>(nullptr);
+      split->prefix_length = matched;
+      memcpy(split->prefix, i->prefix, matched);
+      insert_sorted(split, i->prefix[matched], n);
+      insert_sorted(split, key_byte(bits, depth + matched), new_leaf(key, value));
+      i->prefix_length -= matched + 1;
+      memmove(i->prefix, i->prefix + matched + 1, i->prefix_length);
+      *ref = split;
+      break;
+    }
+    depth += i->prefix_length;
+    node ** child = find_child(i, key_byte(bits, depth));
+    if (!child) {
+      add_child(ref, i, key_byte(bits, depth), new_leaf(key, value));
+      break;
+    }
+    ref = child;
+    ++depth;
+  }
+  ++size_;
+  return true;
+}
+
+template <typename K, typename V>
+bool art_map<K, V>::remove(K const & key) {
+  if (!find(key)) return false;
+  uint64_t bits = key_bits(key);
+  node ** parent_ref = nullptr;
+  node ** ref = &root_;
+  size_t depth = 0;
+  uint8_t byte = 0;
+  while ((*ref)->type != LEAF) {
+    inner * i = static_cast<inner *>(*ref);
+    depth += i->prefix_length;
+    byte = key_byte(bits, depth++);
+    parent_ref = ref;
+    ref = find_child(i, byte);
+  }
+  delete static_cast<leaf *>(*ref);
+  if (parent_ref) {
+    remove_child(parent_ref, static_cast<inner *>(*parent_ref), byte);
+  } else {
+    root_ = nullptr;
+  }
+  --size_;
+  return true;
+}
+
+template <typename K, typename V>
+V const * art_map<K, V>::lookup(K const &key) const {
+  leaf const * l = find(key);
+  return l ? &l->value : nullptr;
+}
+
+template <typename K, typename V>
+V * art_map<K, V>::lookup(K const &key) {
+  return const_cast<V *>(static_cast<const art_map<K, V> *>(this)->lookup(key));
+}
+
+template <typename K, typename V>
+bool art_map<K, V>::contains_key(K const &key) const {
+  return bool(find(key));
+}
+
+template <typename K, typename V>
+template <typename F>
+void art_map<K, V>::for_each(node const * n, F & f) {
+  if (n->type == LEAF) {
+    leaf const * l = static_cast<leaf const *>(n);
+    f(l->key, l->value);
+    return;
+  }
+  for_each_child(static_cast<inner const *>(n), [&f](uint8_t, node const * child) {
+    for_each(child, f);
+    return true;
+  });
+}
+
+template <typename K, typename V>
+template <typename F>
+void art_map<K, V>::for_each(F f) const {
+  if (root_) for_each(root_, f);
+}
+
+/*
+ * Sweeps the subtree `*ref` points to. The children left are gathered and, if
+ * any child went or changed, the node is replaced once: by nothing, by its
+ * only child, or by a node of the type that `remove_child` would shrink it to,
+ * going on down to the smallest type that holds the children.
+ */
+template <typename K, typename V>
+template <typename P>
+size_t art_map<K, V>::erase_if(node ** ref, P & pred) {
+  node * n = *ref;
+  if (n->type == LEAF) {
+    leaf * l = static_cast<leaf *>(n);
+    if (!pred(static_cast<K const &>(l->key), static_cast<V const &>(l->value))) return 0;
+    delete l;
+    *ref = nullptr;
+    return 1;
+  }
+  inner * i = static_cast<inner *>(n);
+  uint8_t bytes[256];
+  node * children[256];
+  size_t count = 0;
+  size_t removed = 0;
+  bool changed = false;
+  for_each_child(i, [&](uint8_t byte, node * child) {
+    node * kept = child;
+    removed += erase_if(&kept, pred);
+    changed = changed || kept != child;
+    if (kept) {
+      bytes[count] = byte;
+      children[count++] = kept;
+    }
+    return true;
+  });
+  if (!changed) return removed;
+  if (count == 0) {
+    *ref = nullptr;
+  } else if (count == 1) {
+    merge_into_child(ref, i, bytes[0], children[0]);
+  } else {
+    // The type stays unless `remove_child` would have shrunk it
+    uint8_t type = i->type;
+    if ((type == NODE16 && count <= 3) || (type == NODE48 && count <= 12) || (type == NODE256 && count <= 40)) {
+      type = count <= 4 ? NODE4 : count <= 16 ? NODE16 : NODE48;
+    }
+    switch (type) {
+      case NODE4: *ref = rebuilt<node4>(i, bytes, children, count); break;
+      case NODE16: *ref = rebuilt<node16>(i, bytes, children, count); break;
+      case NODE48: *ref = rebuilt<node48>(i, bytes, children, count); break;
+      case NODE256: *ref = rebuilt<node256>(i, bytes, children, count); break;
+    }
+  }
+  delete_node(i);
+  return removed;
+}
+
+template <typename K, typename V>
+template <typename P>
+size_t art_map<K, V>::erase_if(P pred) {
+  if (!root_) return 0;
+  size_t removed = erase_if(&root_, pred);
+  size_ -= removed;
+  return removed;
+}
+
+template <typename K, typename V>
+size_t art_map<K, V>::insert(std::pair<K, V> const * pairs, size_t n) {
+  size_t added = 0;
+  for (size_t i = 0; i < n; ++i) {
+    added += add(pairs[i].first, pairs[i].second);
+  }
+  return added;
+}
+
+template <typename K, typename V>
+size_t art_map<K, V>::merge(art_map const & other) {
+  size_t added = 0;
+  other.for_each([&](K const & key, V const & value) { added += add(key, value); });
+  return added;
+}
+
+/*
+ * `from_bound` (`to_bound`) is true while the path to `n` is equal to the
+ * first `depth` bytes of `from` (`to`); only then the bytes of the bound
+ * limit the children to visit
+ */
+template <typename K, typename V>
+template <typename F>
+void art_map<K, V>::for_each_in_range(node const * n, size_t depth, K const & from, K const & to,
+                                      bool from_bound, bool to_bound, F & f) {
+  if (n->type == LEAF) {
+    leaf const * l = static_cast<leaf const *>(n);
+    if (!(l->key < from) && !(to < l->key)) f(l->key, l->value);
+    return;
+  }
+  inner const * i = static_cast<inner const *>(n);
+  uint64_t from_bits = key_bits(from);
+  uint64_t to_bits = key_bits(to);
+  for (size_t p = 0; p < i->prefix_length; ++p, ++depth) {
+    uint8_t byte = i->prefix[p];
+    if (from_bound && byte != key_byte(from_bits, depth)) {
+      if (byte < key_byte(from_bits, depth)) return;
+      from_bound = false;
+    }
+    if (to_bound && byte != key_byte(to_bits, depth)) {
+      if (byte > key_byte(to_bits, depth)) return;
+      to_bound = false;
+    }
+  }
+  uint8_t from_byte = key_byte(from_bits, depth);
+  uint8_t to_byte = key_byte(to_bits, depth);
+  for_each_child(i, [&](uint8_t byte, node const * child) {
+    if (from_bound && byte < from_byte) return true;
+    if (to_bound && byte > to_byte) return false;
+    for_each_in_range(child, depth + 1, from, to, from_bound && byte == from_byte, to_bound && byte == to_byte, f);
+    return true;
+  });
+}
+
+template <typename K, typename V>
+template <typename F>
+void art_map<K, V>::for_each_in_range(K const & from, K const & to, F f) const {
+  if (root_ && !(to < from)) for_each_in_range(root_, 0, from, to, true, true, f);
+}
+
+}  // namespace gtl
@@ -0,0 +1,314 @@
+#pragma once
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include "vector.h"
+#include "benchmark.h"
+
+namespace gtl {
+
+/*
+ * Change of the timings of one benchmark from a baseline.
+ *
+ * `p_value` is the two-sided p-value of the Mann-Whitney U test: the
+ * probability of runs at least this far apart if both sets came from the same
+ * distribution. It is taken from the exact distribution of U for up to
+ * `EXACT_RUNS` runs a side without ties, from the normal approximation with
+ * the tie correction otherwise. `delta` is
+ * the Hodges-Lehmann estimate of current/baseline - 1, the median of the
+ * ratios of every pair of runs, with its distribution-free confidence
+ * interval at level 1 - alpha.
+ */
+struct sample_comparison {
+  double p_value;
+  double delta;
+  double delta_low;
+  double delta_high;
+};
+
+// Nothing is known with fewer than two runs on either side, the comparison
+// is then `p_value` 1 and the ratio of the medians
+inline sample_comparison compare_samples(vector<double> const & baseline, vector<double> const & current,
+                                         double alpha);
+// Smallest `p_value` of `n` runs against `m`, none below `alpha` is
+// significant whatever the timings
+inline double smallest_p_value(size_t n, size_t m);
+
+struct comparison_options {
+  comparison_options()
+    : alpha(0.01)
+    , threshold(0.1)
+  {}
+
+  // Significance level of the test and one minus the confidence level
+  double alpha;
+  // Smallest slowdown reported as a regression, 0.1 is 10%
+  double threshold;
+};
+
+/*
+ * Baselines are the raw run times of every result, one line each:
+ * container, workload, size, operations per run and the runs in nanoseconds,
+ * separated by tabs.
+ */
+inline void save_baseline(benchmark_report const & report, std::string const & path);
+// Results without metrics and latencies, empty if `path` can not be read
+inline vector<benchmark_result> load_baseline(std::string const & path);
+
+/*
+ * Compares every result of `report` with the one of the same container,
+ * workload and size in `baseline` (the n-th repeated one with the n-th) per
+ * operation, prints the changes to `out` and returns the number of
+ * regressions: slowdowns significant at `options.alpha` and estimated at
+ * `options.threshold` or more. The results with too few runs to be significant
+ * at `options.alpha` are listed after the changes.
+ */
+inline size_t compare_report(vector<benchmark_result> const & baseline, benchmark_report const & report,
+                             comparison_options const & options, std::ostream & out);
+
+
+// z with P(Z > z) = p for a standard normal Z
+inline double normal_quantile(double p) {
+  double low = 0;
+  double high = 40;
+  for (size_t i = 0; i < 100; ++i) {
+    double middle = (low + high) / 2;
+    if (0.5 * std::erfc(middle / std::sqrt(2.0)) > p) low = middle;
+    else high = middle;
+  }
+  return (low + high) / 2;
+}
+
+const size_t EXACT_RUNS = 20;
+
+// P(U = u) for u from 0 to n * m, for `n` runs against `m` without ties
+inline vector<double> u_distribution(size_t n, size_t m) {
+  // Ranks are handed out from the fastest, ways[c * (n * m + 1) + u] counts
+  // the orders of the runs so far with `c` current ones and U at `u`. A
+  // current run adds the baseline runs before it to U.
+  size_t width = n * m + 1;
+  vector<double> ways;
+  ways.resize((m + 1) * width, 0);
+  ways[0] = 1;
+  for (size_t t = 0; t < n + m; ++t) {
+    vector<double> next;
+    next.resize(ways.size(), 0);
+    for (size_t c = 0; c <= std::min(t, m); ++c) {
+      size_t b = t - c;
+      if (b > n) continue;
+      for (size_t u = 0; u < width; ++u) {
+        double w = ways[c * width + u];
+        if (w == 0) continue;
+        if (b < n) next[c * width + u] += w;
+        if (c < m) next[(c + 1) * width + u + b] += w;
+      }
+    }
+    ways = next;
+  }
+  double total = 0;
+  for (size_t u = 0; u < width; ++u) {
+    total += ways[m * width + u];
+  }
+  vector<double> distribution(vector<double>::reserve(width));
+  for (size_t u = 0; u < width; ++u) {
+    distribution.push_back(ways[m * width + u] / total);
+  }
+  return distribution;
+}
+
+inline double smallest_p_value(size_t n, size_t m) {
+  if (n < 2 || m < 2) return 1;
+  if (n <= EXACT_RUNS && m <= EXACT_RUNS) return std::min(1.0, 2 * u_distribution(n, m)[0]);
+  double total = (double)(n + m);
+  double distance = (double)n * m / 2 - 0.5;
+  return std::min(1.0, std::erfc(distance / std::sqrt((double)n * m / 6 * (total + 1))));
+}
+
+inline sample_comparison compare_samples(vector<double> const & baseline, vector<double> const & current,
+                                         double alpha) {
+  sample_comparison result = {1, 0, 0, 0};
+  size_t n = baseline.size();
+  size_t m = current.size();
+  if (n < 2 || m < 2) {
+    benchmark_result before("", "", 0, 1), after("", "", 0, 1);
+    before.samples = baseline;
+    after.samples = current;
+    if (before.median() > 0 && after.median() > 0) {
+      result.delta = result.delta_low = result.delta_high = after.median() / before.median() - 1;
+    }
+    return result;
+  }
+
+  // U counts the pairs with the current run slower, ties count half
+  double u = 0;
+  vector<double> log_ratios = vector<double>::reserve(n * m);
+  for (size_t i = 0; i < m; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      if (current[i] > baseline[j]) u += 1;
+      else if (current[i] == baseline[j]) u += 0.5;
+      log_ratios.push_back(std::log(std::max(current[i], 1e-9) / std::max(baseline[j], 1e-9)));
+    }
+  }
+
+  vector<double> all(baseline);
+  all.append(current);
+  std::sort(&all[0], &all[0] + all.size());
+  double ties = 0;
+  for (size_t i = 0; i < all.size();) {
+    size_t j = i;
+    while (j < all.size() && all[j] == all[i]) ++j;
+    double t = (double)(j - i);
+    ties += t * t * t - t;
+    i = j;
+  }
+  double total = (double)(n + m);
+  std::sort(&log_ratios[0], &log_ratios[0] + log_ratios.size());
+  size_t pairs = log_ratios.size();
+  double median = pairs % 2 ? log_ratios[pairs / 2] : (log_ratios[pairs / 2 - 1] + log_ratios[pairs / 2]) / 2;
+  // Order statistic of the pairwise ratios bounding the interval, from the
+  // distribution of U without ties
+  size_t k = 0;
+  if (ties == 0 && n <= EXACT_RUNS && m <= EXACT_RUNS) {
+    // Without ties U is a whole number
+    vector<double> distribution = u_distribution(n, m);
+    size_t observed = (size_t)u;
+    double below = 0;
+    double above = 0;
+    for (size_t i = 0; i < distribution.size(); ++i) {
+      if (i <= observed) below += distribution[i];
+      if (i >= observed) above += distribution[i];
+    }
+    result.p_value = std::min(1.0, 2 * std::min(below, above));
+    // The interval starts at the c-th smallest ratio, for the largest c with
+    // P(U < c) <= alpha / 2
+    size_t c = 0;
+    double tail = distribution[0];
+    while (c < (pairs + 1) / 2 && tail <= alpha / 2) {
+      ++c;
+      tail += distribution[c];
+    }
+    k = c ? c - 1 : 0;
+  } else {
+    double variance = (double)n * m / 12 * (total + 1 - ties / (total * (total - 1)));
+    if (variance > 0) {
+      double distance = std::max(std::fabs(u - (double)n * m / 2) - 0.5, 0.0);
+      result.p_value = std::min(1.0, std::erfc(distance / std::sqrt(2 * variance)));
+    }
+    double bound = (double)n * m / 2 - normal_quantile(alpha / 2) * std::sqrt((double)n * m * (total + 1) / 12);
+    k = bound < 1 ? 0 : std::min((size_t)bound - 1, (pairs - 1) / 2);
+  }
+  result.delta = std::exp(median) - 1;
+  result.delta_low = std::exp(log_ratios[k]) - 1;
+  result.delta_high = std::exp(log_ratios[pairs - 1 - k]) - 1;
+  return result;
+}
+
+inline void save_baseline(benchmark_report const & report, std::string const & path) {
+  std::ofstream f(path);
+  f << std::setprecision(10);
+  for (size_t i = 0; i < report.results.size(); ++i) {
+    benchmark_result const & r = report.results[i];
+    f << r.container << "\t" << r.workload << "\t" << r.size << "\t" << r.n_ops;
+    for (size_t j = 0; j < r.samples.size(); ++j) {
+      f << "\t" << r.samples[j];
+    }
+    f << "\n";
+  }
+}
+
+inline vector<benchmark_result> load_baseline(std::string const & path) {
+  vector<benchmark_result> results;
+  std::ifstream f(path);
+  std::string line;
+  while (std::getline(f, line)) {
+    std::stringstream fields(line);
+    std::string container, workload, size, n_ops, sample;
+    if (!std::getline(fields, container, '\t') || !std::getline(fields, workload, '\t')
+        || !std::getline(fields, size, '\t') || !std::getline(fields, n_ops, '\t')) continue;
+    benchmark_result result(container, workload, std::strtoul(size.c_str(), nullptr, 10),
+                            std::strtoul(n_ops.c_str(), nullptr, 10));
+    while (std::getline(fields, sample, '\t')) {
+      result.samples.push_back(std::strtod(sample.c_str(), nullptr));
+    }
+    results.push_back(result);
+  }
+  return results;
+}
+
+// Run times per operation, so that results with different `n_ops` compare
+inline vector<double> per_op_samples(benchmark_result const & result) {
+  vector<double> samples(result.samples);
+  double n_ops = result.n_ops ? (double)result.n_ops : 1;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i] /= n_ops;
+  }
+  return samples;
+}
+
+inline size_t compare_report(vector<benchmark_result> const & baseline, benchmark_report const & report,
+                             comparison_options const & options, std::ostream & out) {
+  size_t regressions = 0;
+  size_t improvements = 0;
+  size_t unmatched = 0;
+  // Results that can not be significant with their runs
+  vector<std::string> untestable;
+  vector<bool> used = vector<bool>::reserve(baseline.size());
+  for (size_t i = 0; i < baseline.size(); ++i) {
+    used.push_back(false);
+  }
+  for (size_t i = 0; i < report.results.size(); ++i) {
+    benchmark_result const & r = report.results[i];
+    if (r.samples.size() == 0) continue;
+    size_t match = baseline.size();
+    for (size_t j = 0; j < baseline.size() && match == baseline.size(); ++j) {
+      benchmark_result const & b = baseline[j];
+      if (!used[j] && b.container == r.container && b.workload == r.workload && b.size == r.size) match = j;
+    }
+    if (match == baseline.size()) {
+      ++unmatched;
+      continue;
+    }
+    used[match] = true;
+    benchmark_result const & b = baseline[match];
+    sample_comparison c = compare_samples(per_op_samples(b), per_op_samples(r), options.alpha);
+    if (smallest_p_value(b.samples.size(), r.samples.size()) >= options.alpha) {
+      std::stringstream name;
+      name << r.container << " " << r.workload << " " << r.size << " (" << b.samples.size() << " and "
+           << r.samples.size() << " runs)";
+      untestable.push_back(name.str());
+    }
+    bool significant = c.p_value < options.alpha;
+    bool regression = significant && c.delta >= options.threshold;
+    bool improvement = significant && c.delta <= -options.threshold;
+    regressions += regression;
+    improvements += improvement;
+    out << std::left << std::setw(28) << r.container << std::setw(36) << r.workload
+        << std::right << std::setw(10) << r.size
+        << std::fixed << std::setprecision(2)
+        << std::setw(12) << b.ns_per_op() << " -> " << std::setw(12) << r.ns_per_op() << " ns/op "
+        << std::showpos << std::setprecision(1) << std::setw(7) << 100 * c.delta << "% ["
+        << 100 * c.delta_low << "%, " << 100 * c.delta_high << "%]" << std::noshowpos
+        << std::scientific << std::setprecision(1) << "  p=" << c.p_value
+        << (regression ? "  SLOWER" : improvement ? "  faster" : "") << std::endl;
+    out.unsetf(std::ios::floatfield);
+  }
+  out << regressions << " regressions and " << improvements << " improvements of "
+      << 100 * options.threshold << "% or more at p < " << options.alpha;
+  if (unmatched) out << ", " << unmatched << " results not in the baseline";
+  out << std::endl;
+  if (untestable.size()) {
+    out << untestable.size() << " results have too few runs for p < " << options.alpha << ":" << std::endl;
+    for (size_t i = 0; i < untestable.size(); ++i) {
+      out << "  " << untestable[i] << std::endl;
+    }
+  }
+  return regressions;
+}
+
+}  // namespace gtl
@@ -0,0 +1,1166 @@
+#pragma once
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include "vector.h"
+#include "alloc_stats.h"
+#include "histogram.h"
+#include "perf_counters.h"
+#include "bloom_filter.h"
+#include "hash_map.h"
+#include "static_map.h"
+#include "tree_map.h"
+#include "workload.h"
+
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace gtl {
+
+/*
+ * Keeps the compiler from dropping a computation whose result is unused or
+ * moving it out of the timed region
+ */
+template <typename T>
+inline void do_not_optimize(T const & value) {
+  asm volatile("" : : "m"(value) : "memory");
+}
+
+struct benchmark_options {
+  benchmark_options()
+    : warmup_runs(2)
+    , runs(20)
+    , latency_runs(1)
+    , counters(nullptr)
+  {}
+
+  // Runs done before the measured ones and thrown away
+  size_t warmup_runs;
+  size_t runs;
+  // Extra runs timing every operation on its own, for the latency percentiles
+  size_t latency_runs;
+  // Hardware counters read around the measured runs, if not null
+  perf_counters * counters;
+};
+
+/*
+ * Timings of one benchmark: the duration of every measured run in
+ * nanoseconds, each run doing `n_ops` operations on a map of `size` elements.
+ */
+struct benchmark_result {
+  benchmark_result(std::string container, std::string workload, size_t size, size_t n_ops);
+
+  double median() const;
+  double mean() const;
+  double stddev() const;
+  double min() const;
+  double ns_per_op() const;
+
+  // Extra numbers reported next to the timings, e.g. a false positive rate
+  void add_metric(std::string const & name, double value);
+  double metric(std::string const & name) const;
+
+  std::string container;
+  std::string workload;
+  size_t size;
+  size_t n_ops;
+  vector<double> samples;
+  vector<std::pair<std::string, double>> metrics;
+  // Nanoseconds per operation, filled by `measure_latency`
+  latency_histogram latency;
+};
+
+inline benchmark_result::benchmark_result(std::string container, std::string workload, size_t size, size_t n_ops)
+  : container(container)
+  , workload(workload)
+  , size(size)
+  , n_ops(n_ops)
+  , samples()
+  , metrics()
+  , latency()
+{}
+
+inline double benchmark_result::median() const {
+  if (samples.size() == 0) return 0;
+  vector<double> sorted(samples);
+  std::sort(&sorted[0], &sorted[0] + sorted.size());
+  size_t middle = sorted.size() / 2;
+  if (sorted.size() % 2) return sorted[middle];
+  return (sorted[middle - 1] + sorted[middle]) / 2;
+}
+
+inline double benchmark_result::mean() const {
+  double sum = 0;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    sum += samples[i];
+  }
+  return samples.size() ? sum / samples.size() : 0;
+}
+
+inline double benchmark_result::stddev() const {
+  if (samples.size() < 2) return 0;
+  double m = mean();
+  double sum = 0;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    sum += (samples[i] - m) * (samples[i] - m);
+  }
+  return std::sqrt(sum / (samples.size() - 1));
+}
+
+inline double benchmark_result::min() const {
+  if (samples.size() == 0) return 0;
+  return *std::min_element(&samples[0], &samples[0] + samples.size());
+}
+
+inline double benchmark_result::ns_per_op() const {
+  return n_ops ? median() / n_ops : 0;
+}
+
+inline void benchmark_result::add_metric(std::string const & name, double value) {
+  metrics.push_back(std::make_pair(name, value));
+}
+
+inline double benchmark_result::metric(std::string const & name) const {
+  for (size_t i = 0; i < metrics.size(); ++i) {
+    if (metrics[i].first == name) return metrics[i].second;
+  }
+  return 0;
+}
+
+// Adds the counters of the measured runs per operation to the metrics
+inline void add_counters(benchmark_result & result, benchmark_options const & options) {
+  if (!options.counters || result.n_ops == 0 || result.samples.size() == 0) return;
+  double n_ops = (double)result.n_ops * result.samples.size();
+  for (size_t i = 0; i < options.counters->size(); ++i) {
+    result.add_metric(options.counters->name(i) + "_per_op", options.counters->value(i) / n_ops);
+  }
+}
+
+/*
+ * Runs `op()` `options.runs` times after `options.warmup_runs` unmeasured
+ * runs. `op` has to leave its state as it found it (e.g. only do lookups),
+ * otherwise use `measure_fresh`.
+ */
+template <typename Op>
+benchmark_result measure(benchmark_result result, Op op, benchmark_options const & options) {
+  if (options.counters) options.counters->reset();
+  for (size_t run = 0; run < options.warmup_runs + options.runs; ++run) {
+    bool counted = options.counters && run >= options.warmup_runs;
+    if (counted) options.counters->start();
+    auto start_time = std::chrono::steady_clock::now();
+    op();
+    auto end_time = std::chrono::steady_clock::now();
+    if (counted) options.counters->stop();
+    if (run < options.warmup_runs) continue;
+    result.samples.push_back(std::chrono::duration<double, std::nano>(end_time - start_time).count());
+  }
+  add_counters(result, options);
+  return result;
+}
+
+/*
+ * Runs `op(state)` on a fresh `T state`, prepared by the unmeasured
+ * `setup(state)`, for every run
+ */
+template <typename T, typename Setup, typename Op>
+benchmark_result measure_fresh(benchmark_result result, Setup setup, Op op, benchmark_options const & options) {
+  if (options.counters) options.counters->reset();
+  for (size_t run = 0; run < options.warmup_runs + options.runs; ++run) {
+    T state;
+    setup(state);
+    do_not_optimize(state);
+    bool counted = options.counters && run >= options.warmup_runs;
+    if (counted) options.counters->start();
+    auto start_time = std::chrono::steady_clock::now();
+    op(state);
+    do_not_optimize(state);
+    auto end_time = std::chrono::steady_clock::now();
+    if (counted) options.counters->stop();
+    if (run < options.warmup_runs) continue;
+    result.samples.push_back(std::chrono::duration<double, std::nano>(end_time - start_time).count());
+  }
+  add_counters(result, options);
+  return result;
+}
+
+/*
+ * Heap held by a fresh `T state` after `setup(state)` and `op(state)`, its
+ * peak during them, the number of allocations they made and the bytes per
+ * element, counting `sizeof(T)` as well
+ */
+template <typename T, typename Setup, typename Op>
+benchmark_result measure_memory(benchmark_result result, Setup setup, Op op) {
+  alloc_stats before = alloc_stats::current();
+  alloc_stats::reset_peak();
+  T state;
+  setup(state);
+  op(state);
+  alloc_stats after = alloc_stats::current();
+  double heap_bytes = (double)after.live_bytes - before.live_bytes;
+  result.add_metric("heap_bytes", heap_bytes);
+  result.add_metric("heap_usable_bytes", (double)after.usable_bytes - before.usable_bytes);
+  result.add_metric("peak_heap_bytes", (double)after.peak_bytes - before.live_bytes);
+  result.add_metric("allocations", (double)after.allocations - before.allocations);
+  if (state.size()) result.add_metric("bytes_per_entry", (heap_bytes + sizeof(T)) / state.size());
+  return result;
+}
+
+// Smallest measured time between two clock reads
+inline double clock_overhead_ns() {
+  static double overhead = []() {
+    double best = 1e9;
+    for (size_t i = 0; i < 1000; ++i) {
+      auto start_time = std::chrono::steady_clock::now();
+      auto end_time = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<double, std::nano>(end_time - start_time).count());
+    }
+    return best;
+  }();
+  return overhead;
+}
+
+/*
+ * Times every `op.step(state, i)`, for `i` below `op.size()`, on its own and
+ * records it in `result.latency` minus the cost of reading the clock. The
+ * percentiles are added to the metrics.
+ */
+template <typename T, typename Setup, typename Op>
+benchmark_result measure_latency(benchmark_result result, Setup setup, Op op, benchmark_options const & options) {
+  double overhead = clock_overhead_ns();
+  for (size_t run = 0; run < options.latency_runs; ++run) {
+    T state;
+    setup(state);
+    for (size_t i = 0; i < op.size(); ++i) {
+      auto start_time = std::chrono::steady_clock::now();
+      op.step(state, i);
+      auto end_time = std::chrono::steady_clock::now();
+      double ns = std::chrono::duration<double, std::nano>(end_time - start_time).count() - overhead;
+      result.latency.record(ns > 0 ? (uint64_t)(ns + 0.5) : 0);
+    }
+  }
+  if (result.latency.count() == 0) return result;
+  result.add_metric("p50_ns", result.latency.percentile(0.5));
+  result.add_metric("p99_ns", result.latency.percentile(0.99));
+  result.add_metric("p99.9_ns", result.latency.percentile(0.999));
+  result.add_metric("max_ns", result.latency.max());
+  return result;
+}
+
+/*
+ * Collection of benchmark results, printed as they are added and written
+ * out as CSV or JSON
+ */
+struct benchmark_report {
+  explicit benchmark_report(benchmark_options options = benchmark_options());
+
+  benchmark_result const & add(benchmark_result const & result);
+
+  void write_csv(std::string const & path) const;
+  void write_json(std::string const & path) const;
+  // `ns_per_op` of every container (rows) and workload (columns) at one
+  // map size, for gnuplot
+  void write_table(std::string const & path, vector<std::string> const & workloads, size_t size) const;
+  // Latency histograms of `workload` at one map size, a gnuplot data block
+  // per container
+  void write_histograms(std::string const & path, std::string const & workload, size_t size) const;
+
+  benchmark_options options;
+  vector<benchmark_result> results;
+};
+
+inline benchmark_report::benchmark_report(benchmark_options options)
+  : options(options)
+  , results()
+{}
+
+inline benchmark_result const & benchmark_report::add(benchmark_result const & result) {
+  results.push_back(result);
+  std::cout << std::left << std::setw(28) << result.container << std::setw(36) << result.workload
+            << std::right << std::setw(10) << result.size
+            << std::fixed << std::setprecision(2)
+            << std::setw(12) << result.ns_per_op() << " ns/op"
+            << " +- " << std::setprecision(1) << 100 * result.stddev() / std::max(result.mean(), 1e-9) << "%";
+  std::cout.unsetf(std::ios::floatfield);
+  for (size_t i = 0; i < result.metrics.size(); ++i) {
+    std::cout << std::setprecision(6) << "  " << result.metrics[i].first << "=" << result.metrics[i].second;
+  }
+  std::cout << std::endl;
+  std::cout.unsetf(std::ios::floatfield);
+  return results[results.size() - 1];
+}
+
+inline void benchmark_report::write_csv(std::string const & path) const {
+  std::ofstream f(path);
+  f << std::setprecision(10);
+  f << "container,workload,size,n_ops,runs,median_ns,mean_ns,stddev_ns,min_ns,ns_per_op,metrics\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    benchmark_result const & r = results[i];
+    f << r.container << "," << r.workload << "," << r.size << "," << r.n_ops << ","
+      << r.samples.size() << "," << r.median() << "," << r.mean() << "," << r.stddev() << ","
+      << r.min() << "," << r.ns_per_op() << ",";
+    for (size_t j = 0; j < r.metrics.size(); ++j) {
+      f << (j ? ";" : "") << r.metrics[j].first << "=" << r.metrics[j].second;
+    }
+    f << "\n";
+  }
+}
+
+inline void benchmark_report::write_json(std::string const & path) const {
+  std::ofstream f(path);
+  f << std::setprecision(10);
+  f << "[\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    benchmark_result const & r = results[i];
+    f << "  {\"container\": \"" << r.container << "\", \"workload\": \"" << r.workload
+      << "\", \"size\": " << r.size << ", \"n_ops\": " << r.n_ops
+      << ", \"median_ns\": " << r.median() << ", \"mean_ns\": " << r.mean()
+      << ", \"stddev_ns\": " << r.stddev() << ", \"min_ns\": " << r.min()
+      << ", \"ns_per_op\": " << r.ns_per_op() << ", \"samples_ns\": [";
+    for (size_t j = 0; j < r.samples.size(); ++j) {
+      f << (j ? ", " : "") << r.samples[j];
+    }
+    f << "], \"metrics\": {";
+    for (size_t j = 0; j < r.metrics.size(); ++j) {
+      f << (j ? ", " : "") << "\"" << r.metrics[j].first << "\": " << r.metrics[j].second;
+    }
+    f << "}}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  f << "]\n";
+}
+
+inline void benchmark_report::write_table(std::string const & path, vector<std::string> const & workloads,
+                                          size_t size) const {
+  std::ofstream f(path);
+  f << "Map";
+  for (size_t i = 0; i < workloads.size(); ++i) {
+    f << " " << workloads[i];
+  }
+  f << "\n";
+  vector<std::string> containers;
+  for (size_t i = 0; i < results.size(); ++i) {
+    bool seen = false;
+    for (size_t j = 0; j < containers.size(); ++j) {
+      seen = seen || containers[j] == results[i].container;
+    }
+    if (!seen) containers.push_back(results[i].container);
+  }
+  for (size_t i = 0; i < containers.size(); ++i) {
+    std::stringstream row;
+    bool any = false;
+    row << containers[i];
+    for (size_t j = 0; j < workloads.size(); ++j) {
+      std::string value = "-";
+      for (size_t k = 0; k < results.size(); ++k) {
+        if (results[k].container == containers[i] && results[k].workload == workloads[j]
+            && results[k].size == size) {
+          value = std::to_string(results[k].ns_per_op());
+          any = true;
+        }
+      }
+      row << " " << value;
+    }
+    if (any) f << row.str() << "\n";
+  }
+}
+
+inline void benchmark_report::write_histograms(std::string const & path, std::string const & workload,
+                                               size_t size) const {
+  std::ofstream f(path);
+  for (size_t i = 0; i < results.size(); ++i) {
+    benchmark_result const & r = results[i];
+    if (r.workload != workload || r.size != size || r.latency.count() == 0) continue;
+    f << "\"" << r.container << "\" percentile inverse\n";
+    r.latency.write(f);
+    f << "\n\n";
+  }
+}
+
+/*
+ *  Benchmarking for map operations, on the pre-generated keys of a workload
+ */
+template <typename T> struct addition
+{
+  explicit addition(workload const & w) : w(w) {}
+  size_t size() const { return w.keys.size(); }
+  void step(T & map, size_t i) const { map.add(w.keys[i], 0); }
+  void operator() (T & map) const {
+    for (size_t i = 0; i < size(); ++i) {
+      step(map, i);
+    }
+  }
+  workload const & w;
+};
+
+template <typename T> struct search
+{
+  explicit search(workload const & w) : w(w) {}
+  size_t size() const { return w.queries.size(); }
+  void step(T const & map, size_t i) const { do_not_optimize(map.contains_key(w.queries[i])); }
+  workload const & w;
+};
+
+template <typename T> struct deletion
+{
+  explicit deletion(workload const & w) : w(w) {}
+  size_t size() const { return w.removals.size(); }
+  void step(T & map, size_t i) const { map.remove(w.removals[i]); }
+  void operator() (T & map) const {
+    for (size_t i = 0; i < size(); ++i) {
+      step(map, i);
+    }
+  }
+  workload const & w;
+};
+
+template <typename T> struct mixed
+{
+  explicit mixed(workload const & w) : w(w) {}
+  size_t size() const { return w.ops.size(); }
+  void step(T & map, size_t i) const {
+    workload::op const & op = w.ops[i];
+    switch (op.kind) {
+      case workload::LOOKUP: do_not_optimize(map.lookup(op.key)); break;
+      case workload::ADD: map.add(op.key, 0); break;
+      case workload::REMOVE: map.remove(op.key); break;
+    }
+  }
+  void operator() (T & map) const {
+    for (size_t i = 0; i < size(); ++i) {
+      step(map, i);
+    }
+  }
+  workload const & w;
+};
+
+// `contains_key` for all the keys, measured as one run
+template <typename T, typename K>
+std::function<void()> contains_all(T const & map, vector<K> const & keys) {
+  return [&map, &keys]() {
+    size_t found = 0;
+    do_not_optimize(map);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      found += map.contains_key(keys[i]);
+    }
+    do_not_optimize(found);
+  };
+}
+
+/*
+ * Addition of all the keys into an empty map, then search, mixed operations
+ * and deletion of all the keys on a filled map, each with its latency
+ * percentiles and the memory held by the map afterwards. Workloads are named
+ * after the operation and the key distribution, e.g. "Search/zipf(0.99)".
+ */
+template <typename T>
+void benchmark(benchmark_report & report, std::string const & name, workload const & w) {
+  benchmark_options const & options = report.options;
+  auto empty = [](T &) {};
+  addition<T> fill(w);
+  std::string suffix = "/" + w.spec.name();
+  size_t size = w.keys.size();
+  benchmark_result added = measure_fresh<T>(benchmark_result(name, "Addition" + suffix, size, size),
+                                            empty, fill, options);
+  added = measure_memory<T>(added, empty, fill);
+  report.add(measure_latency<T>(added, empty, fill, options));
+
+  T map;
+  fill(map);
+  benchmark_result searched = measure(benchmark_result(name, "Search" + suffix, size, w.queries.size()),
+                                      contains_all(map, w.queries), options);
+  report.add(measure_latency<T>(searched, fill, search<T>(w), options));
+
+  benchmark_result mixed_ops = measure_fresh<T>(benchmark_result(name, "Search+Add+Delete" + suffix, size, w.ops.size()),
+                                                fill, mixed<T>(w), options);
+  mixed_ops = measure_memory<T>(mixed_ops, fill, mixed<T>(w));
+  report.add(measure_latency<T>(mixed_ops, fill, mixed<T>(w), options));
+
+  benchmark_result deleted = measure_fresh<T>(benchmark_result(name, "Deletion" + suffix, size, w.removals.size()),
+                                              fill, deletion<T>(w), options);
+  deleted = measure_memory<T>(deleted, fill, deletion<T>(w));
+  report.add(measure_latency<T>(deleted, fill, deletion<T>(w), options));
+}
+
+/*
+ * Negative lookups on a map with and without a Bloom filter in front of it.
+ * The filtered result reports the false positive rate and the miss speedup.
+ */
+template <typename T>
+void bloom_benchmark(benchmark_report & report, std::string const & name, double bits_per_key) {
+  T map;
+  bloom_map<int, int, T> filtered_map(bits_per_key);
+  size_t n = 100000;
+  // Even keys are present, odd keys are never present
+  vector<int> misses;
+  for (size_t i = 0; i < n; ++i) {
+    int element = rand() % (1 << 29);
+    map.add(2*element, 0);
+    filtered_map.add(2*element, 0);
+    misses.push_back(2*(rand() % (1 << 29)) + 1);
+  }
+  size_t false_positives = 0;
+  for (size_t i = 0; i < n; ++i) {
+    false_positives += filtered_map.filter().may_contain(misses[i]);
+  }
+  benchmark_result plain = measure(benchmark_result(name, "Miss", n, n),
+                                   contains_all(map, misses), report.options);
+  benchmark_result filtered = measure(benchmark_result("Bloom" + name, "Miss", n, n),
+                                      contains_all(filtered_map, misses), report.options);
+  filtered.add_metric("bits_per_key", bits_per_key);
+  filtered.add_metric("false_positive_rate", (double)false_positives / n);
+  filtered.add_metric("miss_speedup", plain.median() / filtered.median());
+  report.add(plain);
+  report.add(filtered);
+}
+
+template <size_t N> struct payload {
+  char bytes[N];
+};
+
+/*
+ * Lookups (half of them hits) in maps with `N`-byte values
+ */
+template <typename T, size_t N>
+void large_value_benchmark(benchmark_report & report, std::string const & name) {
+  T map;
+  size_t n = 100000;
+  vector<int> keys;
+  for (size_t i = 0; i < n; ++i) {
+    int element = rand() % (1 << 29);
+    map.add(2*element, payload<N>());
+    keys.push_back(i % 2 ? 2*element : 2*element + 1);
+  }
+  report.add(measure(benchmark_result(name, "Lookup/" + std::to_string(N) + "B", map.size(), n),
+                     contains_all(map, keys), report.options));
+}
+
+/*
+ * Full scan over a map after half of its elements were removed
+ */
+template <typename T>
+void scan_benchmark(benchmark_report & report, std::string const & name) {
+  T map;
+  size_t n = 100000;
+  vector<int> keys = vector<int>::reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys.push_back(rand() % (1 << 29));
+    map.add(keys[i], i);
+  }
+  for (size_t i = 1; i < n; i += 2) {
+    map.remove(keys[i]);
+  }
+  report.add(measure(benchmark_result(name, "Scan", map.size(), map.size()), [&map]() {
+    size_t sum = 0;
+    do_not_optimize(map);
+    map.for_each([&sum](int, int value) { sum += value; });
+    do_not_optimize(sum);
+  }, report.options));
+}
+
+/*
+ * Lookups (half of them hits) with std::string keys, made of a common prefix
+ * and a random number
+ */
+template <typename T>
+void string_benchmark(benchmark_report & report, std::string const & name) {
+  T map;
+  size_t n = 100000;
+  vector<std::string> keys;
+  for (size_t i = 0; i < n; ++i) {
+    std::string key = "benchmark/key/" + std::to_string(rand());
+    map.add(key, i);
+    keys.push_back(i % 2 ? key : key + "/miss");
+  }
+  report.add(measure(benchmark_result(name, "StringLookup", map.size(), n),
+                     contains_all(map, keys), report.options));
+}
+
+template <typename T> struct map_builder {
+  static T build(vector<int> const & keys) {
+    T map;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      map.add(keys[i], keys[i]);
+    }
+    return map;
+  }
+};
+
+template <typename K, typename V, typename H> struct map_builder<static_map<K, V, H>> {
+  static static_map<K, V, H> build(vector<int> const & keys) {
+    return static_map<K, V, H>::build(&keys[0], &keys[0], keys.size());
+  }
+};
+
+/*
+ * Lookups (half of them hits) in a map built once from `n` keys
+ */
+template <typename T>
+void lookup_benchmark(benchmark_report & report, std::string const & name, size_t n) {
+  vector<int> keys;
+  for (size_t i = 0; i < n; ++i) {
+    keys.push_back(2*(rand() % (1 << 29)));
+  }
+  T const map = map_builder<T>::build(keys);
+  vector<int> queries;
+  for (size_t i = 0; i < 100000; ++i) {
+    int key = keys[rand() % n];
+    queries.push_back(i % 2 ? key : key + 1);
+  }
+  report.add(measure(benchmark_result(name, "FixedSetLookup", n, queries.size()),
+                     contains_all(map, queries), report.options));
+}
+
+// Pins `thread` to `cpu`, where the OS allows it
+inline void pin_thread(std::thread & thread, size_t cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+  (void)thread;
+  (void)cpu;
+#endif
+}
+
+/*
+ * `threads` readers, pinned to different CPUs, each running all the lookups
+ * of `queries` (from its own starting point) on the shared `map`. Returns the
+ * wall time from the start signal until the last reader is done.
+ */
+template <typename T>
+double concurrent_lookups(T const & map, vector<int> const & queries, size_t threads) {
+  std::atomic<size_t> ready(0);
+  std::atomic<bool> go(false);
+  vector<size_t> found = vector<size_t>::reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    found.push_back(0);
+  }
+  std::unique_ptr<std::thread[]> readers(new std::thread[threads]);
+  for (size_t t = 0; t < threads; ++t) {
+    readers[t] = std::thread([&, t]() {
+      size_t n = queries.size();
+      size_t start = t * n / threads;
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      // Counted locally, so the readers only share the map
+      size_t local = 0;
+      for (size_t i = 0; i < n; ++i) {
+        size_t index = start + i < n ? start + i : start + i - n;
+        local += map.contains_key(queries[index]);
+      }
+      found[t] = local;
+    });
+    pin_thread(readers[t], t % std::max<unsigned>(std::thread::hardware_concurrency(), 1));
+  }
+  while (ready.load() < threads) {
+    std::this_thread::yield();
+  }
+  auto start_time = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (size_t t = 0; t < threads; ++t) {
+    readers[t].join();
+  }
+  auto end_time = std::chrono::steady_clock::now();
+  for (size_t t = 1; t < threads; ++t) {
+    assert(found[t] == found[0]);
+  }
+  return std::chrono::duration<double, std::nano>(end_time - start_time).count();
+}
+
+/*
+ * Aggregate lookup throughput of 1, 2, 4, ... up to `max_threads` readers on
+ * one immutable map. `scaling` is the throughput relative to a single reader
+ * and `efficiency` the scaling per thread: with readers only sharing the map
+ * it stays close to 1 while there are free cores, so a low efficiency flags
+ * writes to shared memory (false sharing, counters, locks) on the read path.
+ */
+template <typename T>
+void read_scaling_benchmark(benchmark_report & report, std::string const & name, workload const & w,
+                            size_t max_threads) {
+  T map;
+  addition<T> fill(w);
+  fill(map);
+  T const & readonly = map;
+  double single_thread_rate = 0;
+  for (size_t threads = 1; ; threads = std::min(2 * threads, max_threads)) {
+    size_t n_ops = threads * w.queries.size();
+    benchmark_result result(name, "ReadScaling/" + std::to_string(threads), w.keys.size(), n_ops);
+    for (size_t run = 0; run < report.options.warmup_runs + report.options.runs; ++run) {
+      double ns = concurrent_lookups(readonly, w.queries, threads);
+      if (run >= report.options.warmup_runs) result.samples.push_back(ns);
+    }
+    double rate = n_ops / result.median() * 1e9;
+    if (threads == 1) single_thread_rate = rate;
+    result.add_metric("threads", threads);
+    result.add_metric("lookups_per_sec", rate);
+    result.add_metric("scaling", rate / single_thread_rate);
+    result.add_metric("efficiency", rate / single_thread_rate / threads);
+    report.add(result);
+    bool oversubscribed = threads > std::thread::hardware_concurrency();
+    if (threads > 1 && !oversubscribed && rate / single_thread_rate / threads < 0.5) {
+      std::cout << "  " << name << " reads scale poorly with " << threads
+                << " threads, check for writes to shared memory on the read path" << std::endl;
+    }
+    if (threads == max_threads) break;
+  }
+}
+
+// `hash_map` behind a reader/writer lock, which every lookup takes
+template <typename M> struct rwlock_map {
+  rwlock_map() : map(), lock() { pthread_rwlock_init(&lock, nullptr); }
+  ~rwlock_map() { pthread_rwlock_destroy(&lock); }
+
+  bool add(int key, int value) {
+    pthread_rwlock_wrlock(&lock);
+    bool added = map.add(key, value);
+    pthread_rwlock_unlock(&lock);
+    return added;
+  }
+
+  bool remove(int key) {
+    pthread_rwlock_wrlock(&lock);
+    bool removed = map.remove(key);
+    pthread_rwlock_unlock(&lock);
+    return removed;
+  }
+
+  struct reader {
+    explicit reader(rwlock_map const & map) : map(map) {}
+    bool contains_key(int key) const {
+      pthread_rwlock_rdlock(&map.lock);
+      bool found = map.map.contains_key(key);
+      pthread_rwlock_unlock(&map.lock);
+      return found;
+    }
+    rwlock_map const & map;
+  };
+
+  M map;
+  mutable pthread_rwlock_t lock;
+};
+
+/*
+ * `threads` readers as in `concurrent_lookups`, each through its own
+ * `T::reader`, while a writer thread keeps adding and removing negative keys
+ * (never queried) until they are done. Returns the readers' wall time,
+ * `writes` counts the writer's operations.
+ */
+template <typename T>
+double lookups_under_writes(T & map, vector<int> const & queries, size_t threads, size_t size, size_t & writes) {
+  std::atomic<size_t> ready(0);
+  std::atomic<size_t> done(0);
+  std::atomic<bool> go(false);
+  vector<size_t> found = vector<size_t>::reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    found.push_back(0);
+  }
+  size_t cpus = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+  std::unique_ptr<std::thread[]> readers(new std::thread[threads]);
+  for (size_t t = 0; t < threads; ++t) {
+    readers[t] = std::thread([&, t]() {
+      typename T::reader reader(map);
+      size_t n = queries.size();
+      size_t start = t * n / threads;
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      size_t local = 0;
+      for (size_t i = 0; i < n; ++i) {
+        size_t index = start + i < n ? start + i : start + i - n;
+        local += reader.contains_key(queries[index]);
+      }
+      found[t] = local;
+      done.fetch_add(1);
+    });
+    pin_thread(readers[t], t % cpus);
+  }
+  // Half as many churned keys as the map holds, so tombstones pile up and
+  // the table is replaced every so often
+  size_t window = std::max<size_t>(size / 2, 1);
+  writes = 0;
+  std::thread writer([&]() {
+    while (ready.load() < threads) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; done.load(std::memory_order_relaxed) < threads; ++i) {
+      map.add(-1 - int(i % (2 * window)), int(i));
+      if (i >= window) map.remove(-1 - int((i - window) % (2 * window)));
+      writes += 2;
+    }
+  });
+  pin_thread(writer, threads % cpus);
+  while (ready.load() < threads) {
+    std::this_thread::yield();
+  }
+  auto start_time = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (size_t t = 0; t < threads; ++t) {
+    readers[t].join();
+  }
+  auto end_time = std::chrono::steady_clock::now();
+  writer.join();
+  for (size_t t = 1; t < threads; ++t) {
+    assert(found[t] == found[0]);
+  }
+  return std::chrono::duration<double, std::nano>(end_time - start_time).count();
+}
+
+/*
+ * Aggregate lookup throughput of 1, 2, 4, ... up to `max_threads` readers
+ * while one writer changes the map, with `scaling` and `efficiency` as in
+ * `read_scaling_benchmark`. Readers sharing a lock line with each other and
+ * the writer stop scaling, readers which only load from the map do not.
+ */
+template <typename T>
+void concurrent_read_benchmark(benchmark_report & report, std::string const & name, workload const & w,
+                               size_t max_threads) {
+  double single_thread_rate = 0;
+  for (size_t threads = 1; ; threads = std::min(2 * threads, max_threads)) {
+    size_t n_ops = threads * w.queries.size();
+    benchmark_result result(name, "ReadsUnderWrites/" + std::to_string(threads), w.keys.size(), n_ops);
+    double writes_per_sec = 0;
+    for (size_t run = 0; run < report.options.warmup_runs + report.options.runs; ++run) {
+      T map;
+      for (size_t i = 0; i < w.keys.size(); ++i) {
+        map.add(w.keys[i], int(i));
+      }
+      size_t writes = 0;
+      double ns = lookups_under_writes(map, w.queries, threads, w.keys.size(), writes);
+      if (run < report.options.warmup_runs) continue;
+      result.samples.push_back(ns);
+      writes_per_sec += writes / ns * 1e9 / report.options.runs;
+    }
+    double rate = n_ops / result.median() * 1e9;
+    if (threads == 1) single_thread_rate = rate;
+    result.add_metric("threads", threads);
+    result.add_metric("lookups_per_sec", rate);
+    result.add_metric("scaling", rate / single_thread_rate);
+    result.add_metric("efficiency", rate / single_thread_rate / threads);
+    result.add_metric("writes_per_sec", writes_per_sec);
+    report.add(result);
+    if (threads == max_threads) break;
+  }
+}
+
+/*
+ * Time to build a map from the workload keys with `add`, then with
+ * `T::build_parallel` on 1, 2, 4, ... up to `max_threads` threads
+ */
+template <typename T>
+void build_benchmark(benchmark_report & report, std::string const & name, workload const & w, size_t max_threads) {
+  size_t n = w.keys.size();
+  vector<std::pair<int, int>> pairs = vector<std::pair<int, int>>::reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    pairs.push_back(std::make_pair(w.keys[i], (int)i));
+  }
+  benchmark_result sequential = measure(benchmark_result(name, "Build/add", n, n), [&]() {
+    T map;
+    for (size_t i = 0; i < n; ++i) {
+      map.add(pairs[i].first, pairs[i].second);
+    }
+    do_not_optimize(map);
+  }, report.options);
+  report.add(sequential);
+  double single_thread_ns = 0;
+  for (size_t threads = 1; ; threads = std::min(2 * threads, max_threads)) {
+    benchmark_result result = measure(benchmark_result(name, "Build/parallel/" + std::to_string(threads), n, n), [&]() {
+      T map = T::build_parallel(&pairs[0], n, threads);
+      do_not_optimize(map);
+    }, report.options);
+    if (threads == 1) single_thread_ns = result.median();
+    result.add_metric("threads", threads);
+    result.add_metric("speedup_vs_add", sequential.median() / result.median());
+    result.add_metric("scaling", single_thread_ns / result.median());
+    report.add(result);
+    if (threads == max_threads) break;
+  }
+}
+
+template <typename T, size_t G>
+void batch_lookup_run(benchmark_report & report, std::string const & name, T const & map, workload const & w,
+                      benchmark_result const & sequential) {
+  vector<int const *> results = vector<int const *>::reserve(w.queries.size());
+  for (size_t i = 0; i < w.queries.size(); ++i) {
+    results.push_back(nullptr);
+  }
+  benchmark_result result = measure(benchmark_result(name, "BatchLookup/" + std::to_string(G), w.keys.size(),
+                                                     w.queries.size()), [&]() {
+    do_not_optimize(map);
+    map.template lookup_batch<G>(&w.queries[0], w.queries.size(), &results[0]);
+    do_not_optimize(results[0]);
+  }, report.options);
+  result.add_metric("speedup", sequential.median() / result.median());
+  report.add(result);
+}
+
+/*
+ * Lookups one by one against `lookup_batch` with groups of 4 to 32 lookups
+ * in flight
+ */
+template <typename T>
+void batch_lookup_benchmark(benchmark_report & report, std::string const & name, workload const & w) {
+  T map;
+  addition<T> fill(w);
+  fill(map);
+  benchmark_result sequential = measure(benchmark_result(name, "Lookup", w.keys.size(), w.queries.size()), [&]() {
+    do_not_optimize(map);
+    for (size_t i = 0; i < w.queries.size(); ++i) {
+      do_not_optimize(map.lookup(w.queries[i]));
+    }
+  }, report.options);
+  report.add(sequential);
+  batch_lookup_run<T, 4>(report, name, map, w, sequential);
+  batch_lookup_run<T, 8>(report, name, map, w, sequential);
+  batch_lookup_run<T, 16>(report, name, map, w, sequential);
+  batch_lookup_run<T, 32>(report, name, map, w, sequential);
+}
+
+// `tree_map` used as a priority queue of distinct keys
+template <typename K> struct tree_queue {
+  size_t size() const { return map.size(); }
+  void push(K const & key) { map.add(key, 0); }
+  K const & top() const { return *map.min_key(); }
+  void pop_min() { map.delete_min(); }
+
+  tree_map<K, char> map;
+};
+
+/*
+ * Timer queue keys: a deadline in the high half and a sequence number in the
+ * low half, which keeps the keys distinct
+ */
+inline uint64_t timer_key(uint64_t deadline, size_t sequence) {
+  return deadline << 32 | sequence;
+}
+
+/*
+ * A priority queue of `size` timers: filling it, the hold model of a timer
+ * wheel (pop the earliest timer and push a new one a random delay later,
+ * which keeps the size), and draining it
+ */
+template <typename T>
+void queue_benchmark(benchmark_report & report, std::string const & name, size_t size) {
+  size_t n_ops = 100000;
+  vector<uint64_t> deadlines = vector<uint64_t>::reserve(size);
+  vector<uint64_t> delays = vector<uint64_t>::reserve(n_ops);
+  for (size_t i = 0; i < size; ++i) {
+    deadlines.push_back(timer_key(rand() % size, i));
+  }
+  for (size_t i = 0; i < n_ops; ++i) {
+    delays.push_back(rand() % size + 1);
+  }
+  auto nothing = [](T &) {};
+  auto fill = [&](T & queue) {
+    for (size_t i = 0; i < size; ++i) {
+      queue.push(deadlines[i]);
+    }
+  };
+  auto hold = [&](T & queue) {
+    for (size_t i = 0; i < n_ops; ++i) {
+      uint64_t now = queue.top() >> 32;
+      queue.pop_min();
+      queue.push(timer_key(now + delays[i], size + i));
+    }
+  };
+  auto drain = [](T & queue) {
+    while (queue.size() > 0) {
+      do_not_optimize(queue.top());
+      queue.pop_min();
+    }
+  };
+  benchmark_result push = measure_fresh<T>(benchmark_result(name, "Queue/push", size, size), nothing, fill,
+                                           report.options);
+  report.add(measure_memory<T>(push, nothing, fill));
+  benchmark_result held = measure_fresh<T>(benchmark_result(name, "Queue/hold", size, n_ops), fill, hold,
+                                           report.options);
+  T queue;
+  fill(queue);
+  alloc_stats before = alloc_stats::current();
+  hold(queue);
+  held.add_metric("allocations_per_op", (double)(alloc_stats::current().allocations - before.allocations) / n_ops);
+  report.add(held);
+  report.add(measure_fresh<T>(benchmark_result(name, "Queue/pop_min", size, size), fill, drain, report.options));
+}
+
+// `T::heapify` of `size` timers in one batch
+template <typename T>
+void heapify_benchmark(benchmark_report & report, std::string const & name, size_t size) {
+  vector<uint64_t> deadlines = vector<uint64_t>::reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    deadlines.push_back(timer_key(rand() % size, i));
+  }
+  report.add(measure(benchmark_result(name, "Queue/heapify", size, size), [&]() {
+    T queue = T::heapify(deadlines);
+    do_not_optimize(queue);
+  }, report.options));
+}
+
+// The usual hand-rolled LRU cache: a map to the nodes of a separate use list
+template <typename K, typename V> struct list_lru_cache {
+  typedef std::list<std::pair<K, V>> use_list;
+
+  explicit list_lru_cache(size_t capacity) : capacity(capacity), map(), list() {}
+
+  V * get(K const & key) {
+    typename use_list::iterator * node = map.lookup(key);
+    if (!node) return nullptr;
+    list.splice(list.begin(), list, *node);
+    return &(*node)->second;
+  }
+
+  void put(K const & key, V const & value) {
+    if (V * existing = get(key)) {
+      *existing = value;
+      return;
+    }
+    if (list.size() == capacity) {
+      map.remove(list.back().first);
+      list.pop_back();
+    }
+    list.push_front(std::make_pair(key, value));
+    map.add(key, list.begin());
+  }
+
+  size_t capacity;
+  hash_map<K, typename use_list::iterator> map;
+  use_list list;
+};
+
+/*
+ * Get, and put on a miss, of the workload queries through a cache of
+ * `capacity` keys. Every run starts from a cache warmed by an unmeasured pass
+ * over the queries, so the runs are alike and the hit rate is the one of the
+ * steady state.
+ */
+template <typename T>
+void cache_benchmark(benchmark_report & report, std::string const & name, workload const & w, size_t capacity) {
+  size_t hits = 0;
+  auto query = [&w](T & cache) {
+    size_t found = 0;
+    for (size_t i = 0; i < w.queries.size(); ++i) {
+      int key = w.queries[i];
+      if (cache.get(key)) {
+        ++found;
+      } else {
+        cache.put(key, key);
+      }
+    }
+    return found;
+  };
+  std::string workload_name = "Cache/" + std::to_string(capacity) + "/" + w.spec.name();
+  benchmark_result result = measure_fresh<std::unique_ptr<T>>(
+    benchmark_result(name, workload_name, w.spec.size, w.queries.size()),
+    [&](std::unique_ptr<T> & cache) {
+      cache.reset(new T(capacity));
+      query(*cache);
+    },
+    [&](std::unique_ptr<T> & cache) { hits = query(*cache); }, report.options);
+  result.add_metric("capacity", capacity);
+  result.add_metric("hit_rate", (double)hits / w.queries.size());
+  report.add(result);
+}
+
+// A map used as a set of keys
+template <typename M> struct map_set {
+  size_t size() const { return map.size(); }
+  bool add(int key) { return map.add(key, 0); }
+  bool contains(int key) const { return map.contains_key(key); }
+
+  M map;
+};
+
+/*
+ * A set built from the workload keys, with its memory, and membership tests
+ * of the workload queries. Returns the membership result.
+ */
+template <typename T>
+benchmark_result set_benchmark(benchmark_report & report, std::string const & name, workload const & w) {
+  auto nothing = [](T &) {};
+  auto fill = [&w](T & set) {
+    for (size_t i = 0; i < w.keys.size(); ++i) {
+      set.add(w.keys[i]);
+    }
+  };
+  benchmark_result added = measure_fresh<T>(benchmark_result(name, "Set/add", w.keys.size(), w.keys.size()),
+                                            nothing, fill, report.options);
+  report.add(measure_memory<T>(added, nothing, fill));
+  T set;
+  fill(set);
+  return report.add(measure(benchmark_result(name, "Set/contains", w.keys.size(), w.queries.size()), [&]() {
+    do_not_optimize(set);
+    for (size_t i = 0; i < w.queries.size(); ++i) {
+      do_not_optimize(set.contains(w.queries[i]));
+    }
+  }, report.options));
+}
+
+// `T::contains_batch` of the workload queries, against one by one `sequential`
+template <typename T, size_t G>
+void batch_contains_benchmark(benchmark_report & report, std::string const & name, workload const & w,
+                              benchmark_result const & sequential) {
+  T set;
+  for (size_t i = 0; i < w.keys.size(); ++i) {
+    set.add(w.keys[i]);
+  }
+  std::unique_ptr<bool[]> results(new bool[w.queries.size()]);
+  benchmark_result result = measure(benchmark_result(name, "Set/contains_batch/" + std::to_string(G), w.keys.size(),
+                                                     w.queries.size()), [&]() {
+    do_not_optimize(set);
+    set.template contains_batch<G>(&w.queries[0], w.queries.size(), results.get());
+    do_not_optimize(results[0]);
+  }, report.options);
+  result.add_metric("speedup", sequential.median() / result.median());
+  report.add(result);
+}
+
+/*
+ * A TTL sweep: the values are insertion times and the older half of the
+ * elements expires. `erase_if` removes them in one pass, against finding
+ * their keys with `for_each` and removing them one by one.
+ */
+template <typename T>
+void sweep_benchmark(benchmark_report & report, std::string const & name, workload const & w) {
+  size_t size = w.keys.size();
+  int cutoff = int(size / 2);
+  auto fill = [&w](T & map) {
+    for (size_t i = 0; i < w.keys.size(); ++i) {
+      map.add(w.keys[i], int(i));
+    }
+  };
+  auto expired = [cutoff](int, int time) { return time < cutoff; };
+  benchmark_result removed = measure_fresh<T>(benchmark_result(name, "Sweep/remove", size, size), fill, [&](T & map) {
+    vector<int> keys;
+    map.for_each([&](int key, int time) {
+      if (expired(key, time)) keys.push_back(key);
+    });
+    for (size_t i = 0; i < keys.size(); ++i) {
+      map.remove(keys[i]);
+    }
+  }, report.options);
+  report.add(removed);
+  benchmark_result erased = measure_fresh<T>(benchmark_result(name, "Sweep/erase_if", size, size), fill,
+                                             [&](T & map) { map.erase_if(expired); }, report.options);
+  erased.add_metric("speedup", removed.median() / erased.median());
+  report.add(erased);
+}
+
+}  // namespace gtl
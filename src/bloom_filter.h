@@ -0,0 +1,263 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <cmath>
+#include "vector.h"
+#include "hash.h"
+
+namespace gtl {
+
+/*
+ * A cache-line blocked Bloom filter.
+ *
+ * Every key is mapped to a single 512-bit block and sets `k` bits inside it,
+ * so a membership test touches exactly one cache line. A negative answer is
+ * always right; a positive one is wrong with a probability which depends on
+ * the number of bits per key (about 1% for 10 bits per key).
+ */
+template <typename K, typename H = default_hash<K>> struct bloom_filter {
+  bloom_filter();
+  bloom_filter(size_t n_keys, double bits_per_key);
+
+  void insert(K const &key);
+  bool may_contain(K const &key) const;
+
+  // Number of keys the filter was sized for
+  size_t capacity() const;
+  size_t n_blocks() const;
+  size_t n_hashes() const;
+
+private:
+  static const size_t CACHE_LINE = 64;
+  static const size_t WORDS_PER_BLOCK = CACHE_LINE / sizeof(uint64_t);
+  static const size_t BITS_PER_BLOCK = CACHE_LINE * 8;
+
+  uint64_t const * block(size_t index) const;
+  uint64_t * block(size_t index);
+  size_t block_index(uint64_t hash) const;
+
+  H hasher_;
+  // Over-allocated by one cache line, blocks start at the first aligned word
+  vector<uint64_t> words_;
+  size_t capacity_;
+  size_t n_blocks_;
+  size_t n_hashes_;
+};
+
+template <typename K, typename H>
+bloom_filter<K, H>::bloom_filter()
+  : bloom_filter(0, 10)
+{}
+
+template <typename K, typename H>
+bloom_filter<K, H>::bloom_filter(size_t n_keys, double bits_per_key)
+  : hasher_()
+  , words_()
+  , capacity_(n_keys)
+  , n_blocks_()
+  , n_hashes_()
+{
+  size_t bits = static_cast<size_t>(std::ceil(n_keys * bits_per_key));
+  n_blocks_ = std::max<size_t>(1, (bits + BITS_PER_BLOCK - 1) / BITS_PER_BLOCK);
+  // k = ln(2) * bits per key minimizes the false positive rate
+  long k = std::lround(bits_per_key * 0.69);
+  n_hashes_ = static_cast<size_t>(std::min(16L, std::max(1L, k)));
+  size_t n_words = (n_blocks_ + 1) * WORDS_PER_BLOCK;
+  words_ = vector<uint64_t>::reserve(n_words);
+  for (size_t i = 0; i < n_words; ++i) {
+    words_.push_back(0);
+  }
+}
+
+template <typename K, typename H>
+size_t bloom_filter<K, H>::capacity() const {
+  return capacity_;
+}
+
+template <typename K, typename H>
+size_t bloom_filter<K, H>::n_blocks() const {
+  return n_blocks_;
+}
+
+template <typename K, typename H>
+size_t bloom_filter<K, H>::n_hashes() const {
+  return n_hashes_;
+}
+
+template <typename K, typename H>
+uint64_t const * bloom_filter<K, H>::block(size_t index) const {
+  uintptr_t base = reinterpret_cast<uintptr_t>(&words_[0]);
+  uintptr_t aligned = (base + CACHE_LINE - 1) & ~uintptr_t(CACHE_LINE - 1);
+  return reinterpret_cast<uint64_t const *>(aligned) + index * WORDS_PER_BLOCK;
+}
+
+template <typename K, typename H>
+uint64_t * bloom_filter<K, H>::block(size_t index) {
+  return const_cast<uint64_t *>(static_cast<const bloom_filter<K, H> *>(this)->block(index));
+}
+
+template <typename K, typename H>
+size_t bloom_filter<K, H>::block_index(uint64_t hash) const {
+  // Maps the upper 32 bits onto [0, n_blocks) without a division
+  return static_cast<size_t>(((hash >> 32) * n_blocks_) >> 32);
+}
+
+template <typename K, typename H>
+void bloom_filter<K, H>::insert(K const &key) {
+  uint64_t hash = mix_hash(hasher_(key));
+  uint64_t * words = block(block_index(hash));
+  uint32_t h = static_cast<uint32_t>(hash);
+  for (size_t i = 0; i < n_hashes_; ++i) {
+    uint32_t bit = h >> 23;
+    words[bit >> 6] |= uint64_t(1) << (bit & 63);
+    h *= 0x9e3779b9;
+  }
+}
+
+template <typename K, typename H>
+bool bloom_filter<K, H>::may_contain(K const &key) const {
+  uint64_t hash = mix_hash(hasher_(key));
+  uint64_t const * words = block(block_index(hash));
+  uint32_t h = static_cast<uint32_t>(hash);
+  for (size_t i = 0; i < n_hashes_; ++i) {
+    uint32_t bit = h >> 23;
+    if (!(words[bit >> 6] & (uint64_t(1) << (bit & 63)))) return false;
+    h *= 0x9e3779b9;
+  }
+  return true;
+}
+
+/*
+ * Map adapter which answers most negative lookups with a blocked Bloom filter
+ * before going to the underlying map `M`.
+ *
+ * The filter is updated on every `add`. Removed keys stay in the filter (they
+ * can only cause false positives) until they make up half of it, at which
+ * point the filter is rebuilt from the keys of the map.
+ */
+template <typename K, typename V, typename M, typename H = default_hash<K>> struct bloom_map {
+  explicit bloom_map(double bits_per_key = 10);
+
+  size_t size() const;
+  size_t capacity() const;
+
+  bool add(K const &key, V const &value);
+  bool remove(K const &key);
+
+  V const* lookup(K const &key) const;
+  V * lookup(K const &key);
+
+  bool contains_key(K const &key) const;
+
+  template <typename F> void for_each(F f) const;
+
+  bloom_filter<K, H> const & filter() const;
+  M const & map() const;
+  double bits_per_key() const;
+
+  void trace() const;
+private:
+  void rebuild(size_t n_keys);
+
+  static const size_t MIN_FILTER_KEYS = 64;
+
+  M map_;
+  bloom_filter<K, H> filter_;
+  double bits_per_key_;
+  // Removed keys which are still present in the filter
+  size_t stale_;
+};
+
+template <typename K, typename V, typename M, typename H>
+const size_t bloom_map<K, V, M, H>::MIN_FILTER_KEYS;
+
+template <typename K, typename V, typename M, typename H>
+bloom_map<K, V, M, H>::bloom_map(double bits_per_key)
+  : map_()
+  , filter_(MIN_FILTER_KEYS, bits_per_key)
+  , bits_per_key_(bits_per_key)
+  , stale_(0)
+{}
+
+template <typename K, typename V, typename M, typename H>
+size_t bloom_map<K, V, M, H>::size() const {
+  return map_.size();
+}
+
+template <typename K, typename V, typename M, typename H>
+size_t bloom_map<K, V, M, H>::capacity() const {
+  return map_.capacity();
+}
+
+template <typename K, typename V, typename M, typename H>
+bloom_filter<K, H> const & bloom_map<K, V, M, H>::filter() const {
+  return filter_;
+}
+
+template <typename K, typename V, typename M, typename H>
+M const & bloom_map<K, V, M, H>::map() const {
+  return map_;
+}
+
+template <typename K, typename V, typename M, typename H>
+double bloom_map<K, V, M, H>::bits_per_key() const {
+  return bits_per_key_;
+}
+
+template <typename K, typename V, typename M, typename H>
+void bloom_map<K, V, M, H>::rebuild(size_t n_keys) {
+  bloom_filter<K, H> filter(std::max(n_keys, MIN_FILTER_KEYS), bits_per_key_);
+  map_.for_each([&filter](K const &key, V const &) { filter.insert(key); });
+  filter_ = std::move(filter);
+  stale_ = 0;
+}
+
+template <typename K, typename V, typename M, typename H>
+bool bloom_map<K, V, M, H>::add(K const &key, V const &value) {
+  if (!map_.add(key, value)) return false;
+  if (size() + stale_ > filter_.capacity()) {
+    rebuild(size()*2);
+  } else {
+    filter_.insert(key);
+  }
+  return true;
+}
+
+template <typename K, typename V, typename M, typename H>
+bool bloom_map<K, V, M, H>::remove(K const &key) {
+  if (!filter_.may_contain(key)) return false;
+  if (!map_.remove(key)) return false;
+  if (++stale_ > size()) rebuild(size()*2);
+  return true;
+}
+
+template <typename K, typename V, typename M, typename H>
+bool bloom_map<K, V, M, H>::contains_key(K const &key) const {
+  return filter_.may_contain(key) && map_.contains_key(key);
+}
+
+template <typename K, typename V, typename M, typename H>
+V const * bloom_map<K, V, M, H>::lookup(K const &key) const {
+  if (!filter_.may_contain(key)) return nullptr;
+  return map_.lookup(key);
+}
+
+template <typename K, typename V, typename M, typename H>
+V * bloom_map<K, V, M, H>::lookup(K const &key) {
+  return const_cast<V *>(static_cast<const bloom_map<K, V, M, H> *>(this)->lookup(key));
+}
+
+template <typename K, typename V, typename M, typename H>
+template <typename F>
+void bloom_map<K, V, M, H>::for_each(F f) const {
+  map_.for_each(f);
+}
+
+template <typename K, typename V, typename M, typename H>
+void bloom_map<K, V, M, H>::trace() const {
+  std::cout << "Filter blocks " << filter_.n_blocks() << ", hashes " << filter_.n_hashes()
+            << ", stale keys " << stale_ << std::endl;
+  map_.trace();
+}
+
+}  // namespace gtl
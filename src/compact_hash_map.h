@@ -0,0 +1,351 @@
+#pragma once
+#include "vector.h"
+#include "hash.h"
+#include <string.h>
+#include <stdint.h>
+#include <utility>
+
+namespace gtl {
+  /*
+   * Hash table which keeps its elements in insertion order.
+   *
+   * Elements are packed into a dense array, in the order they were added. The
+   * hash table itself (open addressing and linear probing) only stores indices
+   * into that array, 1, 2, 4 or 8 bytes each depending on the table capacity.
+   * Removed elements are marked as deleted and dropped on the next rehash.
+   */
+  template <typename K, typename V, typename H = default_hash<K>> struct compact_hash_map {
+    compact_hash_map();
+    compact_hash_map(compact_hash_map const &other);
+    compact_hash_map(compact_hash_map &&other);
+
+    void swap(compact_hash_map &other);
+    compact_hash_map &operator=(compact_hash_map other);
+
+    size_t size() const;
+    size_t capacity() const;
+    // Width of a single index of the sparse table in bytes
+    size_t index_width() const;
+
+    bool add(K const &key, V const &value);
+    bool remove(K const &key);
+
+    V const* lookup(K const &key) const;
+    V * lookup(K const &key);
+
+    bool contains_key(K const &key) const;
+
+    // Calls `f(key, value)` for every element in the insertion order
+    template <typename F> void for_each(F f) const;
+
+    /*
+     * Removes the elements for which `pred(key, value)` is true and packs the
+     * rest in one pass, then refills the table in place instead of leaving
+     * deleted entries. Returns the number of removed elements.
+     */
+    template <typename P> size_t erase_if(P pred);
+    // Adds the `n` pairs like `add` in order, the table grows at most once
+    size_t insert(std::pair<K, V> const * pairs, size_t n);
+    // Adds every element of `other` in its order, its values replace those of equal keys
+    size_t merge(compact_hash_map const & other);
+
+    void trace() const;
+  private:
+    struct Entry {
+        K key;
+        V value;
+        bool is_deleted;
+    };
+
+    // Values of the sparse table below this one are not entry indices
+    static const size_t EMPTY = 0;
+    static const size_t DELETED = 1;
+    static const size_t FIRST_ENTRY = 2;
+
+    H hasher_;
+    vector<Entry> entries_;
+    vector<unsigned char> index_;
+    size_t capacity_;
+    size_t index_width_;
+    size_t size_;
+
+    size_t hash(K const & key) const;
+    size_t slot(size_t i) const;
+    void set_slot(size_t i, size_t value);
+    size_t insertion_point(K const &key) const;
+    size_t find(K const & key) const;
+    bool is_overloaded() const;
+    void reallocate();
+    void rehash(size_t capacity);
+    // Rehashes once so that `n` more elements fit below the maximum load
+    void reserve_more(size_t n);
+  };
+
+
+template <typename K, typename V, typename H>
+const size_t compact_hash_map<K, V, H>::EMPTY;
+template <typename K, typename V, typename H>
+const size_t compact_hash_map<K, V, H>::DELETED;
+template <typename K, typename V, typename H>
+const size_t compact_hash_map<K, V, H>::FIRST_ENTRY;
+
+template <typename K, typename V, typename H>
+compact_hash_map<K, V, H>::compact_hash_map()
+  : hasher_()
+  , entries_()
+  , index_()
+  , capacity_()
+  , index_width_(1)
+  , size_()
+{
+}
+
+template <typename K, typename V, typename H>
+void compact_hash_map<K, V, H>::swap(compact_hash_map &other) {
+  std::swap(hasher_, other.hasher_);
+  std::swap(entries_, other.entries_);
+  std::swap(index_, other.index_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(index_width_, other.index_width_);
+  std::swap(size_, other.size_);
+}
+
+template <typename K, typename V, typename H>
+compact_hash_map<K, V, H>::compact_hash_map(compact_hash_map const &other)
+  : hasher_(other.hasher_)
+  , entries_(other.entries_)
+  , index_(other.index_)
+  , capacity_(other.capacity_)
+  , index_width_(other.index_width_)
+  , size_(other.size_)
+{}
+
+template <typename K, typename V, typename H>
+compact_hash_map<K, V, H>::compact_hash_map(compact_hash_map && other)
+  : compact_hash_map()
+{
+  swap(other);
+}
+
+template <typename K, typename V, typename H>
+compact_hash_map<K, V, H> & compact_hash_map<K, V, H>::operator=(compact_hash_map other) {
+  swap(other);
+  return *this;
+}
+
+template <typename K, typename V, typename H>
+size_t compact_hash_map<K, V, H>::size() const {
+  return size_;
+}
+
+template <typename K, typename V, typename H>
+size_t compact_hash_map<K, V, H>::capacity() const {
+  return capacity_;
+}
+
+template <typename K, typename V, typename H>
+size_t compact_hash_map<K, V, H>::index_width() const {
+  return index_width_;
+}
+
+template <typename K, typename V, typename H>
+size_t compact_hash_map<K, V, H>::hash(K const &key) const {
+  if (capacity_ == 0) return 0;
+  return hasher_(key) % capacity_;
+}
+
+template <typename K, typename V, typename H>
+size_t compact_hash_map<K, V, H>::slot(size_t i) const {
+  unsigned char const * p = &index_[i * index_width_];
+  switch (index_width_) {
+    case 1: return *p;
+    case 2: { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+    case 4: { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+    default: { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+  }
+}
+
+template <typename K, typename V, typename H>
+void compact_hash_map<K, V, H>::set_slot(size_t i, size_t value) {
+  unsigned char * p = &index_[i * index_width_];
+  switch (index_width_) {
+    case 1: *p = static_cast<unsigned char>(value); break;
+    case 2: { uint16_t v = value; memcpy(p, &v, sizeof(v)); break; }
+    case 4: { uint32_t v = value; memcpy(p, &v, sizeof(v)); break; }
+    default: { uint64_t v = value; memcpy(p, &v, sizeof(v)); break; }
+  }
+}
+
+template <typename K, typename V, typename H>
+size_t compact_hash_map<K, V, H>::insertion_point(K const &key) const {
+  size_t initial_hash = hash(key);
+  for (size_t i = initial_hash; i < capacity_ + initial_hash; ++i) {
+    size_t ind = i % capacity_;
+    size_t value = slot(ind);
+    if (value == EMPTY) return ind;
+    if (value != DELETED && entries_[value - FIRST_ENTRY].key == key) return ind;
+  }
+  assert(false && "Insertion point not found");
+  return capacity_;
+}
+
+template <typename K, typename V, typename H>
+size_t compact_hash_map<K, V, H>::find(K const &key) const {
+  if (capacity_ == 0) return entries_.size();
+  size_t value = slot(insertion_point(key));
+  if (value == EMPTY) return entries_.size();
+  return value - FIRST_ENTRY;
+}
+
+template <typename K, typename V, typename H>
+bool compact_hash_map<K, V, H>::is_overloaded() const {
+  if (capacity_ == 0) return true;
+  // Every entry, deleted or not, takes a slot of the sparse table
+  return (float)entries_.size()/(float)capacity_ >= OVERLOAD_COEF;
+}
+
+template <typename K, typename V, typename H>
+void compact_hash_map<K, V, H>::reallocate() {
+  size_t capacity = capacity_ == 0 ? 5 : capacity_;
+  // Only drop the deleted elements if they are what overloads the table
+  if ((float)size()/(float)capacity >= OVERLOAD_COEF/2) capacity *= 2;
+  rehash(capacity);
+}
+
+template <typename K, typename V, typename H>
+void compact_hash_map<K, V, H>::rehash(size_t capacity) {
+  // The table is rehashed before the entries outgrow this
+  vector<Entry> entries = vector<Entry>::reserve(capacity * OVERLOAD_COEF + 1);
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (!entries_[i].is_deleted) entries.push_back(std::move(entries_[i]));
+  }
+  entries_ = std::move(entries);
+
+  capacity_ = capacity;
+  size_t max_value = capacity + FIRST_ENTRY;
+  index_width_ = max_value <= UINT8_MAX ? 1 : max_value <= UINT16_MAX ? 2 : max_value <= UINT32_MAX ? 4 : 8;
+  size_t n_bytes = capacity_ * index_width_;
+  index_ = vector<unsigned char>::reserve(n_bytes);
+  for (size_t i = 0; i < n_bytes; ++i) {
+    index_.push_back(EMPTY);
+  }
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    set_slot(insertion_point(entries_[i].key), i + FIRST_ENTRY);
+  }
+}
+
+template <typename K, typename V, typename H>
+void compact_hash_map<K, V, H>::reserve_more(size_t n) {
+  if (capacity_ != 0 && (float)(entries_.size() + n)/(float)capacity_ < OVERLOAD_COEF) return;
+  size_t capacity = capacity_ == 0 ? 5 : capacity_;
+  while ((float)(size() + n)/(float)capacity >= OVERLOAD_COEF) capacity *= 2;
+  rehash(capacity);
+}
+
+template <typename K, typename V, typename H>
+bool compact_hash_map<K, V, H>::add(K const &key, V const &value) {
+  if (is_overloaded()) {
+    reallocate();
+  }
+  size_t ind = insertion_point(key);
+  size_t old_value = slot(ind);
+  if (old_value != EMPTY) {
+    entries_[old_value - FIRST_ENTRY].value = value;
+    return false;
+  }
+  set_slot(ind, entries_.size() + FIRST_ENTRY);
+  entries_.push_back({key, value, false});
+  size_++;
+  return true;
+}
+
+template <typename K, typename V, typename H>
+bool compact_hash_map<K, V, H>::remove(K const &key) {
+  if (capacity_ == 0) return false;
+  size_t ind = insertion_point(key);
+  size_t value = slot(ind);
+  if (value == EMPTY) return false;
+  set_slot(ind, DELETED);
+  Entry & entry = entries_[value - FIRST_ENTRY];
+  entry.is_deleted = true;
+  entry.value = V();
+  size_--;
+  return true;
+}
+
+template <typename K, typename V, typename H>
+bool compact_hash_map<K, V, H>::contains_key(K const &key) const {
+  return find(key) < entries_.size();
+}
+
+template <typename K, typename V, typename H>
+V const * compact_hash_map<K, V, H>::lookup(K const &key) const {
+  size_t index = find(key);
+  if (index == entries_.size()) return nullptr;
+  return &entries_[index].value;
+}
+
+template <typename K, typename V, typename H>
+V * compact_hash_map<K, V, H>::lookup(K const &key) {
+  return const_cast<V *>(static_cast<const compact_hash_map<K, V, H> *>(this)->lookup(key));
+}
+
+template <typename K, typename V, typename H>
+template <typename F>
+void compact_hash_map<K, V, H>::for_each(F f) const {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (!entries_[i].is_deleted) f(entries_[i].key, entries_[i].value);
+  }
+}
+
+template <typename K, typename V, typename H>
+template <typename P>
+size_t compact_hash_map<K, V, H>::erase_if(P pred) {
+  size_t old_size = size_;
+  size_t packed = entries_.erase_if([&pred](Entry const & entry) {
+    return entry.is_deleted || pred(entry.key, entry.value);
+  });
+  size_ = entries_.size();
+  if (packed == 0) return 0;
+  for (size_t i = 0; i < index_.size(); ++i) {
+    index_[i] = EMPTY;
+  }
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    set_slot(insertion_point(entries_[i].key), i + FIRST_ENTRY);
+  }
+  return old_size - size_;
+}
+
+template <typename K, typename V, typename H>
+size_t compact_hash_map<K, V, H>::insert(std::pair<K, V> const * pairs, size_t n) {
+  reserve_more(n);
+  size_t added = 0;
+  for (size_t i = 0; i < n; ++i) {
+    added += add(pairs[i].first, pairs[i].second);
+  }
+  return added;
+}
+
+template <typename K, typename V, typename H>
+size_t compact_hash_map<K, V, H>::merge(compact_hash_map const & other) {
+  reserve_more(other.size());
+  size_t added = 0;
+  other.for_each([&](K const & key, V const & value) { added += add(key, value); });
+  return added;
+}
+
+template <typename K, typename V, typename H>
+void compact_hash_map<K, V, H>::trace() const {
+  std::cout << "Capacity is " << capacity_ << ", size is " << size()
+            << ", index width is " << index_width_ << std::endl;
+  std::cout << "Elements:" << std::endl;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    if (entries_[i].is_deleted) {
+      std::cout << "<deleted>" << std::endl;
+    } else {
+      std::cout << entries_[i].key << ": " << entries_[i].value << std::endl;
+    }
+  }
+}
+
+}  // namespace gtl
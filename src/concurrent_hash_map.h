@@ -0,0 +1,396 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include "vector.h"
+#include "hash.h"
+
+namespace gtl {
+
+  /*
+   * Hash table with open addressing and linear probing for one writer
+   * thread and any number of concurrent reader threads.
+   *
+   * Lookups take no lock and store nothing to memory other threads use.
+   * Every slot is a set of atomics, published with a release store of its
+   * state, and a slot keeps its key until the table is replaced (a removal
+   * leaves a tombstone), so a reader sees every slot either before or after
+   * a change. Growing, shrinking and dropping the tombstones build a new
+   * table and swap an atomic pointer to it. The old table is retired and
+   * freed once no reader can still be in it (epoch based reclamation): during
+   * a lookup a reader shows the epoch it started in, in a slot on a cache
+   * line of its own, which only the writer reads.
+   *
+   * The members of the map are for the writer thread, readers look up through
+   * a `reader` each. Keys and values are copied in and out of the slots, so
+   * they have to be trivially copyable and fit in 8 bytes, for lock-free
+   * atomics.
+   */
+  template <typename K, typename V, typename H = default_hash<K>> struct concurrent_hash_map {
+    static_assert(std::is_trivially_copyable<K>::value && sizeof(K) <= sizeof(uint64_t),
+                  "Keys have to be trivially copyable and at most 8 bytes");
+    static_assert(std::is_trivially_copyable<V>::value && sizeof(V) <= sizeof(uint64_t),
+                  "Values have to be trivially copyable and at most 8 bytes");
+
+    struct reader;
+
+    concurrent_hash_map();
+    // Every reader has to be destroyed before the map
+    ~concurrent_hash_map();
+    concurrent_hash_map(concurrent_hash_map const &) = delete;
+    concurrent_hash_map & operator=(concurrent_hash_map const &) = delete;
+
+    size_t size() const;
+    size_t capacity() const;
+
+    bool add(K const &key, V const &value);
+    bool remove(K const &key);
+
+    // Copies the value of `key` to `value`, false if there is none
+    bool lookup(K const &key, V &value) const;
+    bool contains_key(K const &key) const;
+
+    // Calls `f(key, value)` for every element
+    template <typename F> void for_each(F f) const;
+
+    // Frees the retired tables no reader can be in any more, returns the
+    // number of tables left. Done after every table swap as well.
+    size_t reclaim();
+
+    void trace() const;
+  private:
+    enum { EMPTY = 0, LIVE, DELETED };
+    static const size_t CACHE_LINE = 64;
+
+    // All zero bytes is an empty slot
+    struct Slot {
+      std::atomic<K> key;
+      std::atomic<V> value;
+      std::atomic<uint8_t> state;
+    };
+    struct Table {
+      explicit Table(size_t capacity) : capacity(capacity), slots(new Slot[capacity]()) {}
+      size_t capacity;
+      std::unique_ptr<Slot[]> slots;
+    };
+    struct Retired {
+      Table * table;
+      // First epoch whose readers can only see a newer table
+      uint64_t epoch;
+    };
+    // Epoch of one reader during a lookup, 0 between lookups
+    struct EpochSlot {
+      char padding_before[CACHE_LINE];
+      std::atomic<uint64_t> epoch;
+      bool in_use;
+      EpochSlot * next;
+      char padding_after[CACHE_LINE];
+    };
+
+    size_t find(Table const & table, K const &key) const;
+    size_t insertion_point(Table const & table, K const &key) const;
+    bool is_overloaded() const;
+    bool is_underloaded() const;
+    void reallocate();
+    void rehash(size_t capacity);
+    size_t shrunk_capacity(float max_load) const;
+
+    // What the readers use, only written when the table is replaced
+    char padding_before_[CACHE_LINE];
+    H hasher_;
+    std::atomic<Table *> table_;
+    std::atomic<uint64_t> epoch_;
+    char padding_after_[CACHE_LINE];
+
+    size_t size_;
+    // Number of slots taken by deleted elements
+    size_t deleted_;
+    vector<Retired> retired_;
+    // Taken and given back by the readers under the mutex, never freed
+    // before the map
+    mutable std::mutex readers_mutex_;
+    mutable EpochSlot * readers_;
+  };
+
+  /*
+   * Lookups of one reader thread. A reader holds an epoch slot of the map
+   * while it exists, so a thread should keep its reader rather than create
+   * one per lookup.
+   */
+  template <typename K, typename V, typename H> struct concurrent_hash_map<K, V, H>::reader {
+    explicit reader(concurrent_hash_map const & map);
+    ~reader();
+    reader(reader const &) = delete;
+    reader & operator=(reader const &) = delete;
+
+    bool lookup(K const &key, V &value) const;
+    bool contains_key(K const &key) const;
+
+  private:
+    concurrent_hash_map const & map_;
+    EpochSlot * slot_;
+  };
+
+
+template <typename K, typename V, typename H>
+concurrent_hash_map<K, V, H>::concurrent_hash_map()
+  : hasher_()
+  , table_(nullptr)
+  , epoch_(1)
+  , size_()
+  , deleted_()
+  , retired_()
+  , readers_mutex_()
+  , readers_(nullptr)
+{
+}
+
+template <typename K, typename V, typename H>
+concurrent_hash_map<K, V, H>::~concurrent_hash_map() {
+  while (readers_) {
+    EpochSlot * slot = readers_;
+    assert(!slot->in_use && "Reader outlives the map");
+    readers_ = slot->next;
+    delete slot;
+  }
+  for (size_t i = 0; i < retired_.size(); ++i) {
+    delete retired_[i].table;
+  }
+  delete table_.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename H>
+size_t concurrent_hash_map<K, V, H>::size() const {
+  return size_;
+}
+
+template <typename K, typename V, typename H>
+size_t concurrent_hash_map<K, V, H>::capacity() const {
+  Table const * table = table_.load(std::memory_order_relaxed);
+  return table ? table->capacity : 0;
+}
+
+template <typename K, typename V, typename H>
+size_t concurrent_hash_map<K, V, H>::find(Table const & table, K const &key) const {
+  size_t ind = hasher_(key) % table.capacity;
+  for (size_t i = 0; i < table.capacity; ++i) {
+    Slot const & slot = table.slots[ind];
+    uint8_t state = slot.state.load(std::memory_order_acquire);
+    if (state == EMPTY) break;
+    if (state == LIVE && slot.key.load(std::memory_order_relaxed) == key) return ind;
+    ind = ind + 1 == table.capacity ? 0 : ind + 1;
+  }
+  return table.capacity;
+}
+
+// The writer never reuses a tombstone, a new key always takes an empty slot
+template <typename K, typename V, typename H>
+size_t concurrent_hash_map<K, V, H>::insertion_point(Table const & table, K const &key) const {
+  size_t ind = hasher_(key) % table.capacity;
+  for (size_t i = 0; i < table.capacity; ++i) {
+    Slot const & slot = table.slots[ind];
+    uint8_t state = slot.state.load(std::memory_order_relaxed);
+    if (state == EMPTY || (state == LIVE && slot.key.load(std::memory_order_relaxed) == key)) return ind;
+    ind = ind + 1 == table.capacity ? 0 : ind + 1;
+  }
+  assert(false && "Insertion point not found");
+  return table.capacity;
+}
+
+template <typename K, typename V, typename H>
+bool concurrent_hash_map<K, V, H>::is_overloaded() const {
+  if (capacity() == 0) return true;
+  return (float)(size() + deleted_)/(float)capacity() >= OVERLOAD_COEF;
+}
+
+template <typename K, typename V, typename H>
+bool concurrent_hash_map<K, V, H>::is_underloaded() const {
+  return capacity() > 5 && (float)size()/(float)capacity() < UNDERLOAD_COEF;
+}
+
+template <typename K, typename V, typename H>
+void concurrent_hash_map<K, V, H>::reallocate() {
+  size_t capacity = this->capacity() == 0 ? 5 : this->capacity();
+  // Only drop the deleted elements if they are what overloads the table
+  if ((float)size()/(float)capacity >= OVERLOAD_COEF/2) capacity *= 2;
+  rehash(capacity);
+}
+
+// Capacities stay in the 5 * 2^k sequence of the growing table
+template <typename K, typename V, typename H>
+size_t concurrent_hash_map<K, V, H>::shrunk_capacity(float max_load) const {
+  size_t capacity = this->capacity();
+  while (capacity > 5 && capacity % 2 == 0 && (float)size()/(float)(capacity / 2) < max_load) {
+    capacity /= 2;
+  }
+  return capacity;
+}
+
+/*
+ * The new table is filled before it is published. A reader which starts
+ * after the epoch increment is guaranteed to load the new table, so the old
+ * one can go once every reader in a lookup has started in a later epoch.
+ */
+template <typename K, typename V, typename H>
+void concurrent_hash_map<K, V, H>::rehash(size_t capacity) {
+  Table * old = table_.load(std::memory_order_relaxed);
+  Table * fresh = new Table(capacity);
+  for (size_t i = 0; old && i < old->capacity; ++i) {
+    Slot const & slot = old->slots[i];
+    if (slot.state.load(std::memory_order_relaxed) != LIVE) continue;
+    K key = slot.key.load(std::memory_order_relaxed);
+    Slot & target = fresh->slots[insertion_point(*fresh, key)];
+    target.key.store(key, std::memory_order_relaxed);
+    target.value.store(slot.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    target.state.store(LIVE, std::memory_order_relaxed);
+  }
+  table_.store(fresh, std::memory_order_seq_cst);
+  deleted_ = 0;
+  if (!old) return;
+  retired_.push_back({old, epoch_.fetch_add(1, std::memory_order_seq_cst) + 1});
+  reclaim();
+}
+
+template <typename K, typename V, typename H>
+size_t concurrent_hash_map<K, V, H>::reclaim() {
+  if (retired_.size() == 0) return 0;
+  uint64_t oldest = UINT64_MAX;
+  {
+    std::lock_guard<std::mutex> lock(readers_mutex_);
+    for (EpochSlot const * slot = readers_; slot; slot = slot->next) {
+      uint64_t epoch = slot->epoch.load(std::memory_order_seq_cst);
+      if (epoch != 0) oldest = std::min(oldest, epoch);
+    }
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < retired_.size(); ++i) {
+    if (retired_[i].epoch <= oldest) {
+      delete retired_[i].table;
+    } else {
+      retired_[kept++] = retired_[i];
+    }
+  }
+  retired_.resize(kept);
+  return kept;
+}
+
+template <typename K, typename V, typename H>
+bool concurrent_hash_map<K, V, H>::add(K const &key, V const &value) {
+  if (is_overloaded()) {
+    reallocate();
+  }
+  Table & table = *table_.load(std::memory_order_relaxed);
+  Slot & slot = table.slots[insertion_point(table, key)];
+  if (slot.state.load(std::memory_order_relaxed) == LIVE) {
+    slot.value.store(value, std::memory_order_relaxed);
+    return false;
+  }
+  slot.key.store(key, std::memory_order_relaxed);
+  slot.value.store(value, std::memory_order_relaxed);
+  slot.state.store(LIVE, std::memory_order_release);
+  size_++;
+  return true;
+}
+
+template <typename K, typename V, typename H>
+bool concurrent_hash_map<K, V, H>::remove(K const &key) {
+  Table * table = table_.load(std::memory_order_relaxed);
+  if (!table) return false;
+  size_t index = find(*table, key);
+  if (index == table->capacity) return false;
+  table->slots[index].state.store(DELETED, std::memory_order_release);
+  size_--;
+  deleted_++;
+  if (is_underloaded()) rehash(shrunk_capacity(OVERLOAD_COEF/2));
+  return true;
+}
+
+template <typename K, typename V, typename H>
+bool concurrent_hash_map<K, V, H>::lookup(K const &key, V &value) const {
+  Table const * table = table_.load(std::memory_order_relaxed);
+  if (!table) return false;
+  size_t index = find(*table, key);
+  if (index == table->capacity) return false;
+  value = table->slots[index].value.load(std::memory_order_relaxed);
+  return true;
+}
+
+template <typename K, typename V, typename H>
+bool concurrent_hash_map<K, V, H>::contains_key(K const &key) const {
+  Table const * table = table_.load(std::memory_order_relaxed);
+  return table && find(*table, key) < table->capacity;
+}
+
+template <typename K, typename V, typename H>
+template <typename F>
+void concurrent_hash_map<K, V, H>::for_each(F f) const {
+  Table const * table = table_.load(std::memory_order_relaxed);
+  for (size_t i = 0; table && i < table->capacity; ++i) {
+    Slot const & slot = table->slots[i];
+    if (slot.state.load(std::memory_order_relaxed) != LIVE) continue;
+    f(slot.key.load(std::memory_order_relaxed), slot.value.load(std::memory_order_relaxed));
+  }
+}
+
+template <typename K, typename V, typename H>
+void concurrent_hash_map<K, V, H>::trace() const {
+  std::cout << "Capacity is " << capacity() << ", size is " << size()
+            << ", retired tables " << retired_.size() << std::endl;
+  for_each([](K const &key, V const &value) { std::cout << key << ": " << value << std::endl; });
+}
+
+template <typename K, typename V, typename H>
+concurrent_hash_map<K, V, H>::reader::reader(concurrent_hash_map const & map)
+  : map_(map)
+  , slot_(nullptr)
+{
+  std::lock_guard<std::mutex> lock(map.readers_mutex_);
+  for (EpochSlot * slot = map.readers_; slot && !slot_; slot = slot->next) {
+    if (!slot->in_use) slot_ = slot;
+  }
+  if (!slot_) {
+    slot_ = new EpochSlot();
+    slot_->next = map.readers_;
+    map.readers_ = slot_;
+  }
+  slot_->in_use = true;
+}
+
+template <typename K, typename V, typename H>
+concurrent_hash_map<K, V, H>::reader::~reader() {
+  std::lock_guard<std::mutex> lock(map_.readers_mutex_);
+  slot_->in_use = false;
+}
+
+/*
+ * The epoch store and the table load are sequentially consistent, like the
+ * writer's table store and epoch slot loads. So either this reader loads the
+ * new table, or the writer sees its epoch and keeps the old table.
+ */
+template <typename K, typename V, typename H>
+bool concurrent_hash_map<K, V, H>::reader::lookup(K const &key, V &value) const {
+  slot_->epoch.store(map_.epoch_.load(std::memory_order_acquire), std::memory_order_seq_cst);
+  Table const * table = map_.table_.load(std::memory_order_seq_cst);
+  bool found = false;
+  if (table) {
+    size_t index = map_.find(*table, key);
+    found = index < table->capacity;
+    if (found) value = table->slots[index].value.load(std::memory_order_relaxed);
+  }
+  slot_->epoch.store(0, std::memory_order_release);
+  return found;
+}
+
+template <typename K, typename V, typename H>
+bool concurrent_hash_map<K, V, H>::reader::contains_key(K const &key) const {
+  V value;
+  return lookup(key, value);
+}
+
+}  // namespace gtl
@@ -0,0 +1,466 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include "vector.h"
+#include "hash.h"
+
+namespace gtl {
+  // Maximum load factor of the cuckoo tables, reachable with 4-slot buckets
+  static const float CUCKOO_OVERLOAD_COEF = 0.95;
+
+  /*
+   * Bucketized cuckoo hash table
+   *
+   * Every key has two candidate buckets of `B` slots, so a lookup reads at
+   * most two buckets (and a small stash, only while it is not empty). Buckets
+   * are aligned to cache lines and padded to whole lines, so with the default
+   * 4 slots of keys and values of up to 4 bytes a lookup reads at most two
+   * cache lines; larger buckets take two or more lines each. A slot
+   * keeps a one byte tag from the hash next to the key: probing compares
+   * tags before keys, and the other bucket of a key is computed from its
+   * bucket and tag (partial-key cuckoo hashing), so moving a key never hashes
+   * it again.
+   *
+   * An addition which finds both buckets full searches breadth first for the
+   * shortest chain of keys to move to their other buckets, ending in a free
+   * slot. If there is none within `MAX_SEARCH` buckets the key goes to the
+   * stash, and a full stash makes the table grow. The table only grows at a
+   * load of `CUCKOO_OVERLOAD_COEF` or on a full stash, so it is much denser
+   * than `hash_map`, and removals leave no tombstones.
+   */
+  template <typename K, typename V, typename H = default_hash<K>, size_t B = 4> struct cuckoo_map {
+    cuckoo_map();
+    cuckoo_map(cuckoo_map const &other);
+    cuckoo_map(cuckoo_map &&other);
+
+    void swap(cuckoo_map &other);
+    cuckoo_map &operator=(cuckoo_map other);
+
+    size_t size() const;
+    // Number of slots, without the stash
+    size_t capacity() const;
+
+    bool add(K const &key, V const &value);
+    bool remove(K const &key);
+
+    V const* lookup(K const &key) const;
+    V * lookup(K const &key);
+
+    bool contains_key(K const &key) const;
+
+    // Calls `f(key, value)` for every element
+    template <typename F> void for_each(F f) const;
+
+    // Removes the elements for which `pred(key, value)` is true in one pass,
+    // returns their number
+    template <typename P> size_t erase_if(P pred);
+    // Adds the `n` pairs like `add` in order, the table grows at most once
+    size_t insert(std::pair<K, V> const * pairs, size_t n);
+    // Adds every element of `other`, its values replace those of equal keys
+    size_t merge(cuckoo_map const & other);
+
+    // Number of elements in the stash
+    size_t stash_size() const;
+
+  private:
+    static_assert(B >= 1 && B <= 8, "Buckets hold 1 to 8 slots");
+    static const size_t CACHE_LINE = 64;
+    static const size_t STASH_SIZE = 8;
+    // Buckets visited by the search for a free slot
+    static const size_t MAX_SEARCH = 256;
+
+    struct alignas(CACHE_LINE) Bucket {
+      // 0 for a free slot
+      uint8_t tags[B];
+      K keys[B];
+      V values[B];
+    };
+
+    struct Entry {
+      K key;
+      V value;
+    };
+
+    // A bucket reached by the search, from slot `slot` of bucket `parent`
+    struct search_node {
+      size_t bucket;
+      size_t parent;
+      size_t slot;
+    };
+
+    H hasher_;
+    vector<Bucket> buckets_;
+    vector<Entry> stash_;
+    size_t mask_;
+    size_t size_;
+
+    static uint8_t tag(uint64_t hash);
+    size_t alternate(size_t bucket, uint8_t tag) const;
+    // Slot of `key` in `bucket`, B if it is not there
+    size_t find_in(size_t bucket, uint8_t tag, K const & key) const;
+    size_t free_slot(size_t bucket) const;
+    size_t find_in_stash(K const & key) const;
+    // Places a key which is not in the table, false if it only fits the stash
+    bool place(K const & key, V const & value, uint64_t hash);
+    bool move_to_free_slot(size_t first, size_t second);
+    void unstash();
+    void rehash(size_t buckets);
+    void reserve_more(size_t n);
+  };
+
+template <typename K, typename V, typename H, size_t B>
+const size_t cuckoo_map<K, V, H, B>::STASH_SIZE;
+template <typename K, typename V, typename H, size_t B>
+const size_t cuckoo_map<K, V, H, B>::MAX_SEARCH;
+
+template <typename K, typename V, typename H, size_t B>
+cuckoo_map<K, V, H, B>::cuckoo_map()
+  : hasher_()
+  , buckets_()
+  , stash_()
+  , mask_()
+  , size_()
+{
+}
+
+template <typename K, typename V, typename H, size_t B>
+void cuckoo_map<K, V, H, B>::swap(cuckoo_map &other) {
+  std::swap(hasher_, other.hasher_);
+  std::swap(buckets_, other.buckets_);
+  std::swap(stash_, other.stash_);
+  std::swap(mask_, other.mask_);
+  std::swap(size_, other.size_);
+}
+
+template <typename K, typename V, typename H, size_t B>
+cuckoo_map<K, V, H, B>::cuckoo_map(cuckoo_map const &other)
+  : hasher_(other.hasher_)
+  , buckets_(other.buckets_)
+  , stash_(other.stash_)
+  , mask_(other.mask_)
+  , size_(other.size_)
+{}
+
+template <typename K, typename V, typename H, size_t B>
+cuckoo_map<K, V, H, B>::cuckoo_map(cuckoo_map && other)
+  : cuckoo_map()
+{
+  swap(other);
+}
+
+template <typename K, typename V, typename H, size_t B>
+cuckoo_map<K, V, H, B> & cuckoo_map<K, V, H, B>::operator=(cuckoo_map other) {
+  swap(other);
+  return *this;
+}
+
+template <typename K, typename V, typename H, size_t B>
+size_t cuckoo_map<K, V, H, B>::size() const {
+  return size_;
+}
+
+template <typename K, typename V, typename H, size_t B>
+size_t cuckoo_map<K, V, H, B>::capacity() const {
+  return buckets_.size() * B;
+}
+
+template <typename K, typename V, typename H, size_t B>
+size_t cuckoo_map<K, V, H, B>::stash_size() const {
+  return stash_.size();
+}
+
+// The top byte of the hash, which the bucket index does not use
+template <typename K, typename V, typename H, size_t B>
+uint8_t cuckoo_map<K, V, H, B>::tag(uint64_t hash) {
+  uint8_t t = hash >> 56;
+  return t == 0 ? 1 : t;
+}
+
+// An involution: the alternate of the alternate is the bucket itself
+template <typename K, typename V, typename H, size_t B>
+size_t cuckoo_map<K, V, H, B>::alternate(size_t bucket, uint8_t tag) const {
+  return (bucket ^ (tag * 0x5bd1e995ULL)) & mask_;
+}
+
+template <typename K, typename V, typename H, size_t B>
+size_t cuckoo_map<K, V, H, B>::find_in(size_t bucket, uint8_t tag, K const & key) const {
+  Bucket const & b = buckets_[bucket];
+  for (size_t i = 0; i < B; ++i) {
+    if (b.tags[i] == tag && b.keys[i] == key) return i;
+  }
+  return B;
+}
+
+template <typename K, typename V, typename H, size_t B>
+size_t cuckoo_map<K, V, H, B>::free_slot(size_t bucket) const {
+  Bucket const & b = buckets_[bucket];
+  for (size_t i = 0; i < B; ++i) {
+    if (b.tags[i] == 0) return i;
+  }
+  return B;
+}
+
+template <typename K, typename V, typename H, size_t B>
+size_t cuckoo_map<K, V, H, B>::find_in_stash(K const & key) const {
+  for (size_t i = 0; i < stash_.size(); ++i) {
+    if (stash_[i].key == key) return i;
+  }
+  return stash_.size();
+}
+
+template <typename K, typename V, typename H, size_t B>
+V const * cuckoo_map<K, V, H, B>::lookup(K const &key) const {
+  if (size_ == 0) return nullptr;
+  uint64_t hash = mix_hash(hasher_(key));
+  uint8_t t = tag(hash);
+  size_t first = hash & mask_;
+  size_t second = alternate(first, t);
+  __builtin_prefetch(&buckets_[second]);
+  size_t slot = find_in(first, t, key);
+  if (slot < B) return &buckets_[first].values[slot];
+  slot = find_in(second, t, key);
+  if (slot < B) return &buckets_[second].values[slot];
+  if (stash_.size() == 0) return nullptr;
+  size_t index = find_in_stash(key);
+  if (index < stash_.size()) return &stash_[index].value;
+  return nullptr;
+}
+
+template <typename K, typename V, typename H, size_t B>
+V * cuckoo_map<K, V, H, B>::lookup(K const &key) {
+  return const_cast<V *>(static_cast<const cuckoo_map<K, V, H, B> *>(this)->lookup(key));
+}
+
+template <typename K, typename V, typename H, size_t B>
+bool cuckoo_map<K, V, H, B>::contains_key(K const &key) const {
+  return lookup(key) != nullptr;
+}
+
+/*
+ * Breadth first search from both buckets for a bucket with a free slot. Then
+ * the keys on the path move one step each, starting at the end, which frees
+ * a slot in `first` or `second`.
+ */
+template <typename K, typename V, typename H, size_t B>
+bool cuckoo_map<K, V, H, B>::move_to_free_slot(size_t first, size_t second) {
+  search_node nodes[MAX_SEARCH];
+  size_t count = 0;
+  nodes[count++] = {first, MAX_SEARCH, B};
+  if (second != first) nodes[count++] = {second, MAX_SEARCH, B};
+  for (size_t head = 0; head < count; ++head) {
+    Bucket const & b = buckets_[nodes[head].bucket];
+    for (size_t i = 0; i < B && count < MAX_SEARCH; ++i) {
+      size_t next = alternate(nodes[head].bucket, b.tags[i]);
+      if (next == nodes[head].bucket) continue;
+      nodes[count++] = {next, head, i};
+      size_t free = free_slot(next);
+      if (free == B) continue;
+      // Every key on the path moves to the free slot the next one leaves. A
+      // path through a bucket twice may have changed a key it was found by,
+      // then the moves so far are kept and the search fails.
+      for (size_t node = count - 1; nodes[node].parent != MAX_SEARCH; node = nodes[node].parent) {
+        size_t from_bucket = nodes[nodes[node].parent].bucket;
+        Bucket & from = buckets_[from_bucket];
+        Bucket & to = buckets_[nodes[node].bucket];
+        size_t slot = nodes[node].slot;
+        if (alternate(from_bucket, from.tags[slot]) != nodes[node].bucket) return false;
+        to.tags[free] = from.tags[slot];
+        to.keys[free] = std::move(from.keys[slot]);
+        to.values[free] = std::move(from.values[slot]);
+        from.tags[slot] = 0;
+        free = slot;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename K, typename V, typename H, size_t B>
+bool cuckoo_map<K, V, H, B>::place(K const & key, V const & value, uint64_t hash) {
+  uint8_t t = tag(hash);
+  size_t first = hash & mask_;
+  size_t second = alternate(first, t);
+  size_t bucket = first;
+  size_t slot = free_slot(first);
+  if (slot == B) {
+    bucket = second;
+    slot = free_slot(second);
+  }
+  if (slot == B && move_to_free_slot(first, second)) {
+    bucket = first;
+    slot = free_slot(first);
+    if (slot == B) {
+      bucket = second;
+      slot = free_slot(second);
+    }
+  }
+  if (slot == B) {
+    stash_.push_back({key, value});
+    return false;
+  }
+  Bucket & b = buckets_[bucket];
+  b.tags[slot] = t;
+  b.keys[slot] = key;
+  b.values[slot] = value;
+  return true;
+}
+
+template <typename K, typename V, typename H, size_t B>
+void cuckoo_map<K, V, H, B>::rehash(size_t buckets) {
+  vector<Bucket> old_buckets = vector<Bucket>::reserve(buckets);
+  for (size_t i = 0; i < buckets; ++i) {
+    old_buckets.push_back(Bucket());
+    std::fill(old_buckets[i].tags, old_buckets[i].tags + B, 0);
+  }
+  old_buckets.swap(buckets_);
+  vector<Entry> old_stash;
+  old_stash.swap(stash_);
+  mask_ = buckets - 1;
+  for (size_t i = 0; i < old_buckets.size(); ++i) {
+    Bucket const & b = old_buckets[i];
+    for (size_t j = 0; j < B; ++j) {
+      if (b.tags[j] != 0) place(b.keys[j], b.values[j], mix_hash(hasher_(b.keys[j])));
+    }
+  }
+  for (size_t i = 0; i < old_stash.size(); ++i) {
+    place(old_stash[i].key, old_stash[i].value, mix_hash(hasher_(old_stash[i].key)));
+  }
+  if (stash_.size() > STASH_SIZE) {
+    // Not one more slot a key can take: the hash gives too many keys one pair of buckets
+    assert(size_ > capacity() / 4 && "Too many keys with the same hash");
+    rehash(buckets * 2);
+  }
+}
+
+// Grows by doubling until `n` more elements fit below the maximum load
+template <typename K, typename V, typename H, size_t B>
+void cuckoo_map<K, V, H, B>::reserve_more(size_t n) {
+  size_t buckets = std::max<size_t>(buckets_.size(), 2);
+  while ((float)(size_ + n) > CUCKOO_OVERLOAD_COEF * buckets * B) buckets *= 2;
+  if (buckets != buckets_.size()) rehash(buckets);
+}
+
+template <typename K, typename V, typename H, size_t B>
+bool cuckoo_map<K, V, H, B>::add(K const &key, V const &value) {
+  V * old_value = lookup(key);
+  if (old_value) {
+    *old_value = value;
+    return false;
+  }
+  reserve_more(1);
+  size_++;
+  place(key, value, mix_hash(hasher_(key)));
+  if (stash_.size() > STASH_SIZE) rehash(buckets_.size() * 2);
+  return true;
+}
+
+// Stashed keys take the slots removals free in their buckets
+template <typename K, typename V, typename H, size_t B>
+void cuckoo_map<K, V, H, B>::unstash() {
+  for (size_t i = 0; i < stash_.size(); ) {
+    uint64_t hash = mix_hash(hasher_(stash_[i].key));
+    uint8_t t = tag(hash);
+    size_t first = hash & mask_;
+    size_t second = alternate(first, t);
+    size_t bucket = first;
+    size_t slot = free_slot(first);
+    if (slot == B) {
+      bucket = second;
+      slot = free_slot(second);
+    }
+    if (slot == B) {
+      ++i;
+      continue;
+    }
+    Bucket & b = buckets_[bucket];
+    b.tags[slot] = t;
+    b.keys[slot] = std::move(stash_[i].key);
+    b.values[slot] = std::move(stash_[i].value);
+    stash_.swap_remove(i);
+  }
+}
+
+template <typename K, typename V, typename H, size_t B>
+bool cuckoo_map<K, V, H, B>::remove(K const &key) {
+  if (size_ == 0) return false;
+  uint64_t hash = mix_hash(hasher_(key));
+  uint8_t t = tag(hash);
+  size_t first = hash & mask_;
+  size_t buckets[] = {first, alternate(first, t)};
+  for (size_t bucket : buckets) {
+    size_t slot = find_in(bucket, t, key);
+    if (slot == B) continue;
+    Bucket & b = buckets_[bucket];
+    b.tags[slot] = 0;
+    b.keys[slot] = K();
+    b.values[slot] = V();
+    size_--;
+    if (stash_.size() > 0) unstash();
+    return true;
+  }
+  size_t index = find_in_stash(key);
+  if (index == stash_.size()) return false;
+  stash_.swap_remove(index);
+  size_--;
+  return true;
+}
+
+template <typename K, typename V, typename H, size_t B>
+template <typename F>
+void cuckoo_map<K, V, H, B>::for_each(F f) const {
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    Bucket const & b = buckets_[i];
+    for (size_t j = 0; j < B; ++j) {
+      if (b.tags[j] != 0) f(b.keys[j], b.values[j]);
+    }
+  }
+  for (size_t i = 0; i < stash_.size(); ++i) {
+    f(stash_[i].key, stash_[i].value);
+  }
+}
+
+template <typename K, typename V, typename H, size_t B>
+template <typename P>
+size_t cuckoo_map<K, V, H, B>::erase_if(P pred) {
+  size_t removed = 0;
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    Bucket & b = buckets_[i];
+    for (size_t j = 0; j < B; ++j) {
+      K const & key = b.keys[j];
+      V const & value = b.values[j];
+      if (b.tags[j] == 0 || !pred(key, value)) continue;
+      b.tags[j] = 0;
+      b.keys[j] = K();
+      b.values[j] = V();
+      ++removed;
+    }
+  }
+  removed += stash_.erase_if([&pred](Entry const & entry) { return pred(entry.key, entry.value); });
+  size_ -= removed;
+  if (stash_.size() > 0) unstash();
+  return removed;
+}
+
+template <typename K, typename V, typename H, size_t B>
+size_t cuckoo_map<K, V, H, B>::insert(std::pair<K, V> const * pairs, size_t n) {
+  reserve_more(n);
+  size_t added = 0;
+  for (size_t i = 0; i < n; ++i) {
+    added += add(pairs[i].first, pairs[i].second);
+  }
+  return added;
+}
+
+template <typename K, typename V, typename H, size_t B>
+size_t cuckoo_map<K, V, H, B>::merge(cuckoo_map const & other) {
+  reserve_more(other.size());
+  size_t added = 0;
+  other.for_each([&](K const & key, V const & value) { added += add(key, value); });
+  return added;
+}
+
+}  // namespace gtl
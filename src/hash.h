@@ -0,0 +1,128 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+
+namespace gtl {
+  template <typename K> struct default_hash {
+    size_t operator() (K const & key) const { return key; }
+  };
+
+  // Maximum load factor of the open addressing tables
+  static const float OVERLOAD_COEF = 0.75;
+  // Load factor below which a table shrinks, a quarter of the maximum so that
+  // a table does not shrink and grow back around one size
+  static const float UNDERLOAD_COEF = OVERLOAD_COEF / 4;
+
+  /*
+   * The MurmurHash3 finalizer. Spreads the entropy of a weak hash (like the
+   * identity `default_hash`) over all 64 bits.
+   */
+  inline uint64_t mix_hash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  /*
+   * MurmurHash64A, reads the data 8 bytes at a time
+   */
+  inline uint64_t hash_bytes(void const * data, size_t len) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    uint64_t h = 0x8445d61a4e774912ULL ^ (len * m);
+    unsigned char const * p = static_cast<unsigned char const *>(data);
+    for (; len >= 8; len -= 8, p += 8) {
+      uint64_t k;
+      memcpy(&k, p, sizeof(k));
+      k *= m;
+      k ^= k >> r;
+      k *= m;
+      h ^= k;
+      h *= m;
+    }
+    if (len > 0) {
+      uint64_t tail = 0;
+      for (size_t i = 0; i < len; ++i) {
+        tail |= uint64_t(p[i]) << (8 * i);
+      }
+      h ^= tail;
+      h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+  }
+
+  /*
+   * A non-owning reference to a string, used to look up string keys without
+   * building a temporary std::string.
+   */
+  struct string_view {
+    string_view(char const * data) : data_(data), size_(strlen(data)) {}
+    string_view(char const * data, size_t size) : data_(data), size_(size) {}
+    string_view(std::string const & s) : data_(s.data()), size_(s.size()) {}
+
+    char const * data() const { return data_; }
+    size_t size() const { return size_; }
+
+  private:
+    char const * data_;
+    size_t size_;
+  };
+
+  inline bool operator==(std::string const & a, string_view b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), b.size()) == 0;
+  }
+
+  /*
+   * String hash, which also accepts `string_view` and `char const *`.
+   * Maps with a hash declaring `is_transparent` can be queried with any of
+   * these types.
+   */
+  template <> struct default_hash<std::string> {
+    typedef void is_transparent;
+
+    size_t operator() (string_view key) const { return hash_bytes(key.data(), key.size()); }
+    size_t operator() (std::string const & key) const { return hash_bytes(key.data(), key.size()); }
+    size_t operator() (char const * key) const { return hash_bytes(key, strlen(key)); }
+  };
+
+  template <typename T> struct void_type { typedef void type; };
+
+  // `R` if the hash `H` allows heterogeneous lookup with a key of type `Q`
+  template <typename H, typename Q, typename R, typename = void> struct if_transparent {};
+  template <typename H, typename Q, typename R>
+  struct if_transparent<H, Q, R, typename void_type<typename H::is_transparent>::type> {
+    typedef R type;
+  };
+
+  /*
+   * Hash value stored next to a key when comparing or rehashing keys is
+   * expensive (anything which is not a scalar). Stores nothing otherwise.
+   */
+  template <bool> struct stored_hash {
+    stored_hash(size_t = 0) {}
+    bool matches(size_t) const { return true; }
+    template <typename H, typename K> size_t get(H const & hasher, K const & key) const { return hasher(key); }
+  };
+
+  template <> struct stored_hash<true> {
+    stored_hash(size_t value = 0) : value(value) {}
+    bool matches(size_t hash) const { return value == hash; }
+    template <typename H, typename K> size_t get(H const &, K const &) const { return value; }
+
+    size_t value;
+  };
+
+  template <typename K> struct cache_hash {
+    static const bool value = !std::is_scalar<K>::value;
+  };
+
+}  // namespace gtl
@@ -1,17 +1,76 @@
+#pragma once
 #include "vector.h"
+#include "hash.h"
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <thread>
 #include <utility>
 
 namespace gtl {
-  template <typename K> struct default_hash {
-    size_t operator() (K const & key) const { return key; }
+  struct hash_map_stats {
+    size_t size;
+    size_t capacity;
+    double load_factor;
+    // Slots taken by deleted elements
+    size_t tombstones;
+    // Distance of the elements from their home slot
+    double average_probe_length;
+    size_t max_probe_length;
+    // Number of elements at every distance from their home slot
+    vector<size_t> probe_histogram;
+    // Only counted if the map is compiled with statistics
+    size_t rehashes;
+    double rehash_ns;
   };
 
-  static const float OVERLOAD_COEF = 0.75;
+  // Calls `f(0)`, ..., `f(threads - 1)` on `threads` threads and waits for them
+  template <typename F> void run_parallel(size_t threads, F f) {
+    std::unique_ptr<std::thread[]> workers(new std::thread[threads]);
+    for (size_t t = 1; t < threads; ++t) {
+      workers[t] = std::thread(f, t);
+    }
+    f(0);
+    for (size_t t = 1; t < threads; ++t) {
+      workers[t].join();
+    }
+  }
+
+  // Rehash counters, empty unless enabled
+  template <bool> struct rehash_counters {
+    void begin() {}
+    void end() {}
+    size_t rehashes() const { return 0; }
+    double nanoseconds() const { return 0; }
+  };
+
+  template <> struct rehash_counters<true> {
+    rehash_counters() : start_(), rehashes_(), nanoseconds_() {}
+    void begin() { start_ = std::chrono::steady_clock::now(); }
+    void end() {
+      ++rehashes_;
+      nanoseconds_ += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start_).count();
+    }
+    size_t rehashes() const { return rehashes_; }
+    double nanoseconds() const { return nanoseconds_; }
+
+  private:
+    std::chrono::steady_clock::time_point start_;
+    size_t rehashes_;
+    double nanoseconds_;
+  };
 
   /*
    * Hash table with open addressing and linear probing
+   *
+   * For non-scalar keys (e.g. std::string) the full hash of the key is stored
+   * in the table, so probing compares hashes before keys and rehashing does
+   * not hash the keys again.
+   *
+   * With `STATS` the map also counts its rehashes and the time spent in them,
+   * otherwise the counters are compiled out.
    */
-  template <typename K, typename V, typename H = default_hash<K>> struct hash_map {
+  template <typename K, typename V, typename H = default_hash<K>, bool STATS = false> struct hash_map {
     hash_map();
     hash_map(hash_map const &other);
     hash_map(hash_map &&other);
@@ -19,6 +78,12 @@ namespace gtl {
     void swap(hash_map &other);
     hash_map &operator=(hash_map other);
 
+    /*
+     * Same map as `add` of all the pairs in order (the last value of a
+     * duplicate key wins), built on `threads` threads (0 for one per CPU)
+     */
+    static hash_map build_parallel(std::pair<K, V> const * pairs, size_t n, size_t threads = 0);
+
     size_t size() const;
     size_t capacity() const;
 
@@ -30,6 +95,48 @@ namespace gtl {
 
     bool contains_key(K const &key) const;
 
+    // Lookups by any key type `Q` the hash accepts, if `H` is transparent
+    template <typename Q> typename if_transparent<H, Q, bool>::type remove(Q const &key);
+    template <typename Q> typename if_transparent<H, Q, V const *>::type lookup(Q const &key) const;
+    template <typename Q> typename if_transparent<H, Q, V *>::type lookup(Q const &key);
+    template <typename Q> typename if_transparent<H, Q, bool>::type contains_key(Q const &key) const;
+
+    // Calls `f(key, value)` for every element
+    template <typename F> void for_each(F f) const;
+
+    /*
+     * Removes the elements for which `pred(key, value)` is true in one pass
+     * over the table, leaving tombstones like `remove`, and shrinks the table
+     * if that takes the load below `UNDERLOAD_COEF`. Returns the number of
+     * removed elements.
+     */
+    template <typename P> size_t erase_if(P pred);
+    // Adds the `n` pairs like `add` in order, the table grows at most once
+    size_t insert(std::pair<K, V> const * pairs, size_t n);
+    // Adds every element of `other`, its values replace those of equal keys
+    size_t merge(hash_map const & other);
+
+    // Load and probe length statistics, computed by a pass over the table
+    hash_map_stats stats() const;
+
+    /*
+     * Rehashes into the smallest table which keeps the load below the
+     * maximum, dropping the tombstones. The table also shrinks by itself when
+     * a removal takes the load below `UNDERLOAD_COEF`, to a load below half
+     * the maximum so that it has room to grow again.
+     */
+    void shrink_to_fit();
+
+    /*
+     * Clears tombstones in place, visiting about `budget` slots (a cluster
+     * of taken slots is always finished). Elements move back into the
+     * tombstones in front of them, and the tombstones which no probe has to
+     * pass any more become empty. Repeated calls sweep the table in bounded
+     * slices, so a long running map gets rid of its tombstones without the
+     * pause of a full rehash. Returns the number of tombstones left.
+     */
+    size_t compact_step(size_t budget);
+
     void trace() const;
   private:
     struct Entry {
@@ -37,159 +144,489 @@ namespace gtl {
         V value;
         bool is_empty;
         bool is_deleted;
+        stored_hash<cache_hash<K>::value> hash;
     };
     H hasher_;
     vector<Entry> vector_;
 
-    size_t hash(K const & key, size_t capacity) const;
-    size_t find(K const & key) const;
+    template <typename Q> size_t find(Q const & key) const;
+    template <typename Q> bool remove_key(Q const & key);
     bool is_overloaded() const;
+    bool is_underloaded() const;
     void reallocate();
-    size_t insertion_point(vector<Entry> const & vect, K const &key) const;
-    bool add_to_vector(K const &key, V value, vector<Entry> & vect);
+    void rehash(size_t capacity);
+    size_t shrunk_capacity(float max_load) const;
+    // Rehashes once so that `n` more elements fit below the maximum load
+    void reserve_more(size_t n);
+    size_t compact_cluster(size_t first, size_t & steps);
+    template <typename Q>
+    size_t insertion_point(vector<Entry> const & vect, Q const &key, size_t hash) const;
+    bool add_to_vector(K const &key, V value, size_t hash, vector<Entry> & vect);
+    size_t region_insertion_point(K const &key, size_t hash, size_t end) const;
 
     size_t size_;
+    // Number of slots taken by deleted elements
+    size_t deleted_;
+    // Empty slot before the next cluster `compact_step` works on
+    size_t compact_cursor_;
+    rehash_counters<STATS> counters_;
   };
 
 
-template <typename K, typename V, typename H>
-hash_map<K, V, H>::hash_map()
+template <typename K, typename V, typename H, bool STATS>
+hash_map<K, V, H, STATS>::hash_map()
   : hasher_()
   , vector_()
   , size_()
+  , deleted_()
+  , compact_cursor_()
+  , counters_()
 {
 }
 
-template <typename K, typename V, typename H>
-void hash_map<K, V, H>::swap(hash_map &other) {
+template <typename K, typename V, typename H, bool STATS>
+void hash_map<K, V, H, STATS>::swap(hash_map &other) {
+  std::swap(hasher_, other.hasher_);
   std::swap(vector_, other.vector_);
+  std::swap(size_, other.size_);
+  std::swap(deleted_, other.deleted_);
+  std::swap(compact_cursor_, other.compact_cursor_);
+  std::swap(counters_, other.counters_);
 }
 
-template <typename K, typename V, typename H>
-hash_map<K, V, H>::hash_map(hash_map const &other)
-  : vector_(other.vector_)
+template <typename K, typename V, typename H, bool STATS>
+hash_map<K, V, H, STATS>::hash_map(hash_map const &other)
+  : hasher_(other.hasher_)
+  , vector_(other.vector_)
+  , size_(other.size_)
+  , deleted_(other.deleted_)
+  , compact_cursor_(other.compact_cursor_)
+  , counters_(other.counters_)
 {}
 
-template <typename K, typename V, typename H>
-hash_map<K, V, H>::hash_map(hash_map && other)
-  : vector_()
+template <typename K, typename V, typename H, bool STATS>
+hash_map<K, V, H, STATS>::hash_map(hash_map && other)
+  : hasher_()
+  , vector_()
+  , size_()
+  , deleted_()
+  , compact_cursor_()
+  , counters_()
 {
   swap(other);
 }
 
-template <typename K, typename V, typename H>
-hash_map<K, V, H> & hash_map<K, V, H>::operator=(hash_map other) {
+template <typename K, typename V, typename H, bool STATS>
+hash_map<K, V, H, STATS> & hash_map<K, V, H, STATS>::operator=(hash_map other) {
   swap(other);
   return *this;
 }
 
-template <typename K, typename V, typename H>
-size_t hash_map<K, V, H>::size() const {
+template <typename K, typename V, typename H, bool STATS>
+size_t hash_map<K, V, H, STATS>::size() const {
   return size_;
 }
 
-template <typename K, typename V, typename H>
-size_t hash_map<K, V, H>::capacity() const {
+template <typename K, typename V, typename H, bool STATS>
+size_t hash_map<K, V, H, STATS>::capacity() const {
   return vector_.capacity();
 }
 
-template <typename K, typename V, typename H>
-size_t hash_map<K, V, H>::hash(K const &key, size_t capacity) const {
-  if (capacity == 0) return 0;
-  return hasher_(key) % capacity;
-}
-
-template <typename K, typename V, typename H>
-size_t hash_map<K, V, H>::insertion_point(vector<Entry> const & vect, K const &key) const {
-  size_t initial_hash = hash(key, vect.capacity());
+template <typename K, typename V, typename H, bool STATS>
+template <typename Q>
+size_t hash_map<K, V, H, STATS>::insertion_point(vector<Entry> const & vect, Q const &key, size_t hash) const {
+  size_t initial_hash = hash % vect.capacity();
   for (size_t i = initial_hash; i < vect.capacity() + initial_hash; ++i) {
     size_t ind = i % vect.capacity();
     bool is_empty = vect[ind].is_empty && !vect[ind].is_deleted;
-    bool is_found = !vect[ind].is_empty && vect[ind].key == key;
+    bool is_found = !vect[ind].is_empty && vect[ind].hash.matches(hash) && vect[ind].key == key;
     if (is_empty || is_found) return ind;
   }
   assert(false && "Insertion point not found");
+  return vect.capacity();
 }
 
-template <typename K, typename V, typename H>
-size_t hash_map<K, V, H>::find(K const &key) const {
+template <typename K, typename V, typename H, bool STATS>
+template <typename Q>
+size_t hash_map<K, V, H, STATS>::find(Q const &key) const {
   if (vector_.capacity() == 0) return 0;
-  size_t insertion_index = insertion_point(vector_, key);
+  size_t insertion_index = insertion_point(vector_, key, hasher_(key));
   if (vector_[insertion_index].is_empty) return capacity();
   return insertion_index;
 }
 
-template <typename K, typename V, typename H>
-bool hash_map<K, V, H>::add_to_vector(K const &key, V value, vector<Entry> & vect) {
-  if (vector_.capacity() == 0) return 0;
-  size_t ind = insertion_point(vect, key);
+template <typename K, typename V, typename H, bool STATS>
+bool hash_map<K, V, H, STATS>::add_to_vector(K const &key, V value, size_t hash, vector<Entry> & vect) {
+  if (vect.capacity() == 0) return false;
+  size_t ind = insertion_point(vect, key, hash);
   bool result = vect[ind].is_empty;
-  vect[ind] = {key, value, false, false};
+  vect[ind] = {key, value, false, false, hash};
   return result;
 }
 
-template <typename K, typename V, typename H>
-void hash_map<K, V, H>::reallocate() {
+template <typename K, typename V, typename H, bool STATS>
+void hash_map<K, V, H, STATS>::reallocate() {
+  size_t capacity = vector_.capacity() == 0 ? 5 : vector_.capacity();
+  // Only drop the deleted elements if they are what overloads the table
+  if ((float)size()/(float)capacity >= OVERLOAD_COEF/2) capacity *= 2;
+  rehash(capacity);
+}
+
+template <typename K, typename V, typename H, bool STATS>
+void hash_map<K, V, H, STATS>::rehash(size_t capacity) {
+  counters_.begin();
   vector<Entry> new_vector;
-  size_t capacity = vector_.capacity() == 0 ? 5 : vector_.capacity()*2;
-  new_vector.reserve(capacity);
+  new_vector = vector<Entry>::reserve(capacity);
   for (size_t i = 0; i < new_vector.capacity(); ++i) {
-    new_vector.push_back({K(), V(), true, false});
+    new_vector.push_back({K(), V(), true, false, 0});
   }
-  size_ = 0;
   for (size_t i = 0; i < vector_.capacity(); ++i) {
     if (!vector_[i].is_empty) {
-      add_to_vector(vector_[i].key, vector_[i].value, new_vector);
+      Entry const & entry = vector_[i];
+      add_to_vector(entry.key, entry.value, entry.hash.get(hasher_, entry.key), new_vector);
     }
   }
   vector_ = std::move(new_vector);
+  deleted_ = 0;
+  compact_cursor_ = 0;
+  counters_.end();
+}
+
+// Capacities stay in the 5 * 2^k sequence of the growing table
+template <typename K, typename V, typename H, bool STATS>
+size_t hash_map<K, V, H, STATS>::shrunk_capacity(float max_load) const {
+  size_t capacity = vector_.capacity();
+  while (capacity > 5 && capacity % 2 == 0 && (float)size()/(float)(capacity / 2) < max_load) {
+    capacity /= 2;
+  }
+  return capacity;
+}
+
+template <typename K, typename V, typename H, bool STATS>
+void hash_map<K, V, H, STATS>::reserve_more(size_t n) {
+  if (capacity() != 0 && (float)(size() + deleted_ + n)/(float)capacity() < OVERLOAD_COEF) return;
+  size_t capacity = vector_.capacity() == 0 ? 5 : vector_.capacity();
+  while ((float)(size() + n)/(float)capacity >= OVERLOAD_COEF) capacity *= 2;
+  rehash(capacity);
+}
+
+template <typename K, typename V, typename H, bool STATS>
+void hash_map<K, V, H, STATS>::shrink_to_fit() {
+  size_t capacity = shrunk_capacity(OVERLOAD_COEF);
+  if (capacity < vector_.capacity() || deleted_ > 0) rehash(capacity);
+}
+
+/*
+ * Compacts the cluster (a run of taken slots between two empty ones) from
+ * `first` on. Every element moves to the first tombstone after its home, if
+ * there is one before it. Then every element is reached from its home through
+ * elements only, and the tombstones left in the cluster become empty. Returns
+ * the empty slot after the cluster, `steps` counts the visited slots.
+ */
+template <typename K, typename V, typename H, bool STATS>
+size_t hash_map<K, V, H, STATS>::compact_cluster(size_t first, size_t & steps) {
+  size_t capacity = vector_.capacity();
+  auto next = [capacity](size_t slot) { return slot + 1 == capacity ? 0 : slot + 1; };
+  size_t ind = first;
+  bool after_tombstone = false;
+  for (; !vector_[ind].is_empty || vector_[ind].is_deleted; ind = next(ind)) {
+    steps++;
+    Entry & entry = vector_[ind];
+    if (entry.is_deleted) {
+      after_tombstone = true;
+      continue;
+    }
+    if (!after_tombstone) continue;
+    for (size_t slot = entry.hash.get(hasher_, entry.key) % capacity; slot != ind; slot = next(slot)) {
+      steps++;
+      if (vector_[slot].is_deleted) {
+        vector_[slot] = std::move(entry);
+        entry = {K(), V(), true, true, 0};
+        break;
+      }
+    }
+  }
+  if (!after_tombstone) return ind;
+  for (size_t slot = first; slot != ind; slot = next(slot)) {
+    if (!vector_[slot].is_deleted) continue;
+    vector_[slot].is_deleted = false;
+    deleted_--;
+  }
+  return ind;
 }
 
-template <typename K, typename V, typename H>
-bool hash_map<K, V, H>::add(K const &key, V const &value) {
+/*
+ * The homes of a cluster's elements are in the cluster, so the cursor always
+ * stops on an empty slot, and an addition which fills it in between calls
+ * only makes the next call skip to the next empty one.
+ */
+template <typename K, typename V, typename H, bool STATS>
+size_t hash_map<K, V, H, STATS>::compact_step(size_t budget) {
+  size_t steps = 0;
+  while (steps < budget && deleted_ > 0) {
+    steps++;
+    size_t first = compact_cursor_ + 1 == capacity() ? 0 : compact_cursor_ + 1;
+    if (!vector_[compact_cursor_].is_empty || vector_[compact_cursor_].is_deleted) {
+      compact_cursor_ = first;
+      continue;
+    }
+    compact_cursor_ = compact_cluster(first, steps);
+  }
+  return deleted_;
+}
+
+template <typename K, typename V, typename H, bool STATS>
+bool hash_map<K, V, H, STATS>::add(K const &key, V const &value) {
   if (is_overloaded()) {
     reallocate();
   }
-  bool result = add_to_vector(key, value, vector_);
+  bool result = add_to_vector(key, value, hasher_(key), vector_);
   if (result) size_++;
   return result;
 }
 
-template <typename K, typename V, typename H>
-bool hash_map<K, V, H>::is_overloaded() const {
+template <typename K, typename V, typename H, bool STATS>
+size_t hash_map<K, V, H, STATS>::region_insertion_point(K const &key, size_t hash, size_t end) const {
+  for (size_t ind = hash % capacity(); ind < end; ++ind) {
+    bool is_empty = vector_[ind].is_empty;
+    bool is_found = !is_empty && vector_[ind].hash.matches(hash) && vector_[ind].key == key;
+    if (is_empty || is_found) return ind;
+  }
+  return end;
+}
+
+/*
+ * The table is sized for all the pairs up front and split into one region of
+ * consecutive slots per thread. Pairs are partitioned by the region of their
+ * home slot, keeping the input order, and every thread probes only inside its
+ * own region, so no locks are needed. All copies of a key go to the same
+ * region in input order, so the last value wins. A key whose probe reaches
+ * the end of its region is left for a sequential pass at the end, which also
+ * keeps the order as copies of such a key can't fit in the region either.
+ */
+template <typename K, typename V, typename H, bool STATS>
+hash_map<K, V, H, STATS> hash_map<K, V, H, STATS>::build_parallel(std::pair<K, V> const * pairs, size_t n,
+                                                                  size_t threads) {
+  hash_map map;
+  if (threads == 0) threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  threads = std::max<size_t>(std::min(threads, n / 1024), 1);
+  size_t capacity = 5;
+  while ((float)n / (float)capacity >= OVERLOAD_COEF) capacity *= 2;
+  map.vector_ = vector<Entry>::reserve(capacity);
+  for (size_t i = 0; i < capacity; ++i) {
+    map.vector_.push_back({K(), V(), true, false, 0});
+  }
+  auto region = [&](size_t i) { return map.hasher_(pairs[i].first) % capacity * threads / capacity; };
+
+  // Pairs of every input chunk per region
+  size_t chunk = (n + threads - 1) / threads;
+  std::unique_ptr<size_t[]> counts(new size_t[threads * threads]);
+  run_parallel(threads, [&](size_t c) {
+    std::unique_ptr<size_t[]> local(new size_t[threads]());
+    for (size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i) {
+      ++local[region(i)];
+    }
+    for (size_t r = 0; r < threads; ++r) {
+      counts[c * threads + r] = local[r];
+    }
+  });
+
+  // Region by region, chunk by chunk, so every region keeps the input order
+  std::unique_ptr<size_t[]> region_start(new size_t[threads + 1]);
+  size_t offset = 0;
+  for (size_t r = 0; r < threads; ++r) {
+    region_start[r] = offset;
+    for (size_t c = 0; c < threads; ++c) {
+      size_t count = counts[c * threads + r];
+      counts[c * threads + r] = offset;
+      offset += count;
+    }
+  }
+  region_start[threads] = offset;
+  std::unique_ptr<size_t[]> order(new size_t[n]);
+  run_parallel(threads, [&](size_t c) {
+    for (size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i) {
+      order[counts[c * threads + region(i)]++] = i;
+    }
+  });
+
+  vector<vector<size_t>> deferred = vector<vector<size_t>>::reserve(threads);
+  vector<size_t> added = vector<size_t>::reserve(threads);
+  for (size_t r = 0; r < threads; ++r) {
+    deferred.push_back(vector<size_t>());
+    added.push_back(0);
+  }
+  run_parallel(threads, [&](size_t r) {
+    // First slot of the next region
+    size_t end = (capacity * (r + 1) + threads - 1) / threads;
+    size_t local_added = 0;
+    for (size_t k = region_start[r]; k < region_start[r + 1]; ++k) {
+      std::pair<K, V> const & pair = pairs[order[k]];
+      size_t hash = map.hasher_(pair.first);
+      size_t ind = map.region_insertion_point(pair.first, hash, end);
+      if (ind == end) {
+        deferred[r].push_back(order[k]);
+        continue;
+      }
+      local_added += map.vector_[ind].is_empty;
+      map.vector_[ind] = {pair.first, pair.second, false, false, hash};
+    }
+    added[r] = local_added;
+  });
+
+  for (size_t r = 0; r < threads; ++r) {
+    map.size_ += added[r];
+    for (size_t k = 0; k < deferred[r].size(); ++k) {
+      std::pair<K, V> const & pair = pairs[deferred[r][k]];
+      map.size_ += map.add_to_vector(pair.first, pair.second, map.hasher_(pair.first), map.vector_);
+    }
+  }
+  return map;
+}
+
+template <typename K, typename V, typename H, bool STATS>
+bool hash_map<K, V, H, STATS>::is_overloaded() const {
   if (capacity() == 0) return true;
-  return (float)size()/(float)capacity() >= OVERLOAD_COEF;
+  return (float)(size() + deleted_)/(float)capacity() >= OVERLOAD_COEF;
+}
+
+template <typename K, typename V, typename H, bool STATS>
+bool hash_map<K, V, H, STATS>::is_underloaded() const {
+  return capacity() > 5 && (float)size()/(float)capacity() < UNDERLOAD_COEF;
 }
 
-template <typename K, typename V, typename H>
-bool hash_map<K, V, H>::remove(K const &key) {
+template <typename K, typename V, typename H, bool STATS>
+template <typename Q>
+bool hash_map<K, V, H, STATS>::remove_key(Q const &key) {
   size_t index = find(key);
   if (index == capacity()) return false;
-  vector_[index] = {K(), V(), true, true};
+  vector_[index] = {K(), V(), true, true, 0};
   size_--;
+  deleted_++;
+  if (is_underloaded()) rehash(shrunk_capacity(OVERLOAD_COEF/2));
   return true;
 }
 
-template <typename K, typename V, typename H>
-bool hash_map<K, V, H>::contains_key(K const &key) const {
+template <typename K, typename V, typename H, bool STATS>
+bool hash_map<K, V, H, STATS>::remove(K const &key) {
+  return remove_key(key);
+}
+
+template <typename K, typename V, typename H, bool STATS>
+template <typename Q>
+auto hash_map<K, V, H, STATS>::remove(Q const &key) -> typename if_transparent<H, Q, bool>::type {
+  return remove_key(key);
+}
+
+template <typename K, typename V, typename H, bool STATS>
+bool hash_map<K, V, H, STATS>::contains_key(K const &key) const {
+  return find(key) < capacity();
+}
+
+template <typename K, typename V, typename H, bool STATS>
+V const * hash_map<K, V, H, STATS>::lookup(K const &key) const {
+  size_t index = find(key);
+  if (index == capacity()) return nullptr;
+  return &vector_[index].value;
+}
+
+template <typename K, typename V, typename H, bool STATS>
+V * hash_map<K, V, H, STATS>::lookup(K const &key) {
+  return const_cast<V *>(static_cast<const hash_map<K, V, H, STATS> *>(this)->lookup(key));
+}
+
+template <typename K, typename V, typename H, bool STATS>
+template <typename Q>
+auto hash_map<K, V, H, STATS>::contains_key(Q const &key) const -> typename if_transparent<H, Q, bool>::type {
   return find(key) < capacity();
 }
 
-template <typename K, typename V, typename H>
-V const * hash_map<K, V, H>::lookup(K const &key) const {
+template <typename K, typename V, typename H, bool STATS>
+template <typename Q>
+auto hash_map<K, V, H, STATS>::lookup(Q const &key) const -> typename if_transparent<H, Q, V const *>::type {
   size_t index = find(key);
   if (index == capacity()) return nullptr;
   return &vector_[index].value;
 }
 
-template <typename K, typename V, typename H>
-V * hash_map<K, V, H>::lookup(K const &key) {
-  return const_cast<V *>(static_cast<const hash_map<K, V, H> *>(this)->lookup(key));
+template <typename K, typename V, typename H, bool STATS>
+template <typename Q>
+auto hash_map<K, V, H, STATS>::lookup(Q const &key) -> typename if_transparent<H, Q, V *>::type {
+  return const_cast<V *>(static_cast<const hash_map<K, V, H, STATS> *>(this)->lookup(key));
+}
+
+template <typename K, typename V, typename H, bool STATS>
+template <typename F>
+void hash_map<K, V, H, STATS>::for_each(F f) const {
+  for (size_t i = 0; i < vector_.capacity(); ++i) {
+    if (!vector_[i].is_empty) f(vector_[i].key, vector_[i].value);
+  }
+}
+
+template <typename K, typename V, typename H, bool STATS>
+template <typename P>
+size_t hash_map<K, V, H, STATS>::erase_if(P pred) {
+  size_t removed = 0;
+  for (size_t i = 0; i < vector_.capacity(); ++i) {
+    Entry const & entry = vector_[i];
+    if (entry.is_empty || !pred(entry.key, entry.value)) continue;
+    vector_[i] = {K(), V(), true, true, 0};
+    ++removed;
+  }
+  size_ -= removed;
+  deleted_ += removed;
+  if (is_underloaded()) rehash(shrunk_capacity(OVERLOAD_COEF/2));
+  return removed;
+}
+
+template <typename K, typename V, typename H, bool STATS>
+size_t hash_map<K, V, H, STATS>::insert(std::pair<K, V> const * pairs, size_t n) {
+  reserve_more(n);
+  size_t added = 0;
+  for (size_t i = 0; i < n; ++i) {
+    added += add(pairs[i].first, pairs[i].second);
+  }
+  return added;
+}
+
+template <typename K, typename V, typename H, bool STATS>
+size_t hash_map<K, V, H, STATS>::merge(hash_map const & other) {
+  reserve_more(other.size());
+  size_t added = 0;
+  other.for_each([&](K const & key, V const & value) { added += add(key, value); });
+  return added;
 }
 
+template <typename K, typename V, typename H, bool STATS>
+hash_map_stats hash_map<K, V, H, STATS>::stats() const {
+  hash_map_stats result;
+  result.size = size_;
+  result.capacity = capacity();
+  result.load_factor = capacity() ? (double)size_ / capacity() : 0;
+  result.tombstones = deleted_;
+  result.max_probe_length = 0;
+  result.probe_histogram = vector<size_t>();
+  size_t total = 0;
+  for (size_t i = 0; i < vector_.capacity(); ++i) {
+    Entry const & entry = vector_[i];
+    if (entry.is_empty) continue;
+    size_t home = entry.hash.get(hasher_, entry.key) % capacity();
+    size_t length = (i + capacity() - home) % capacity();
+    while (result.probe_histogram.size() <= length) {
+      result.probe_histogram.push_back(0);
+    }
+    ++result.probe_histogram[length];
+    total += length;
+    result.max_probe_length = std::max(result.max_probe_length, length);
+  }
+  result.average_probe_length = size_ ? (double)total / size_ : 0;
+  result.rehashes = counters_.rehashes();
+  result.rehash_ns = counters_.nanoseconds();
+  return result;
+}
 
-template <typename K, typename V, typename H>
-void hash_map<K, V, H>::trace() const {
+template <typename K, typename V, typename H, bool STATS>
+void hash_map<K, V, H, STATS>::trace() const {
   std::cout << "Capacity is " << vector_.capacity() << ", size is " << size() << std::endl;
   std::cout << "Elements:" << std::endl;
   for (size_t i = 0; i < vector_.capacity(); ++i) {
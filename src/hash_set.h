@@ -0,0 +1,247 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+#include "vector.h"
+#include "hash.h"
+
+namespace gtl {
+  /*
+   * Hash set with open addressing and linear probing
+   *
+   * A slot is only the key: whether it is empty, deleted or taken is kept in
+   * a separate bit array, 2 bits per slot. For 32-bit keys the table takes
+   * about a third of a `hash_map<int, int>` of the same capacity, which
+   * stores a value and two flags next to every key.
+   */
+  template <typename K, typename H = default_hash<K>> struct hash_set {
+    hash_set();
+    hash_set(hash_set const &other);
+    hash_set(hash_set &&other);
+
+    void swap(hash_set &other);
+    hash_set &operator=(hash_set other);
+
+    size_t size() const;
+    size_t capacity() const;
+
+    bool add(K const &key);
+    bool remove(K const &key);
+    bool contains(K const &key) const;
+
+    /*
+     * `results[i] = contains(keys[i])` for `n` keys. The home slots of `G`
+     * keys are computed and prefetched before any of them is probed, so their
+     * cache misses overlap.
+     */
+    template <size_t G = 16> void contains_batch(K const * keys, size_t n, bool * results) const;
+
+    // Calls `f(key)` for every element
+    template <typename F> void for_each(F f) const;
+
+  private:
+    enum { EMPTY, DELETED, LIVE };
+    static const size_t SLOTS_PER_WORD = 32;
+
+    H hasher_;
+    vector<K> keys_;
+    vector<uint64_t> states_;
+
+    unsigned state(size_t index) const;
+    void set_state(size_t index, unsigned state);
+    size_t home(K const & key) const;
+    size_t insertion_point(K const &key, size_t index) const;
+    size_t find(K const & key) const;
+    bool is_overloaded() const;
+    void reallocate();
+
+    size_t size_;
+    // Number of slots taken by deleted elements
+    size_t deleted_;
+  };
+
+template <typename K, typename H>
+hash_set<K, H>::hash_set()
+  : hasher_()
+  , keys_()
+  , states_()
+  , size_()
+  , deleted_()
+{
+}
+
+template <typename K, typename H>
+void hash_set<K, H>::swap(hash_set &other) {
+  std::swap(hasher_, other.hasher_);
+  std::swap(keys_, other.keys_);
+  std::swap(states_, other.states_);
+  std::swap(size_, other.size_);
+  std::swap(deleted_, other.deleted_);
+}
+
+template <typename K, typename H>
+hash_set<K, H>::hash_set(hash_set const &other)
+  : hasher_(other.hasher_)
+  , keys_(other.keys_)
+  , states_(other.states_)
+  , size_(other.size_)
+  , deleted_(other.deleted_)
+{}
+
+template <typename K, typename H>
+hash_set<K, H>::hash_set(hash_set && other)
+  : hasher_()
+  , keys_()
+  , states_()
+  , size_()
+  , deleted_()
+{
+  swap(other);
+}
+
+template <typename K, typename H>
+hash_set<K, H> & hash_set<K, H>::operator=(hash_set other) {
+  swap(other);
+  return *this;
+}
+
+template <typename K, typename H>
+size_t hash_set<K, H>::size() const {
+  return size_;
+}
+
+template <typename K, typename H>
+size_t hash_set<K, H>::capacity() const {
+  return keys_.capacity();
+}
+
+template <typename K, typename H>
+unsigned hash_set<K, H>::state(size_t index) const {
+  return (states_[index / SLOTS_PER_WORD] >> (2 * (index % SLOTS_PER_WORD))) & 3;
+}
+
+template <typename K, typename H>
+void hash_set<K, H>::set_state(size_t index, unsigned state) {
+  uint64_t & word = states_[index / SLOTS_PER_WORD];
+  size_t shift = 2 * (index % SLOTS_PER_WORD);
+  word = (word & ~(uint64_t(3) << shift)) | (uint64_t(state) << shift);
+}
+
+template <typename K, typename H>
+size_t hash_set<K, H>::home(K const & key) const {
+  return hasher_(key) % capacity();
+}
+
+// First slot from `index` on which is either empty or holds `key`
+template <typename K, typename H>
+size_t hash_set<K, H>::insertion_point(K const &key, size_t index) const {
+  for (size_t i = 0; i < capacity(); ++i) {
+    unsigned s = state(index);
+    if (s == EMPTY || (s == LIVE && keys_[index] == key)) return index;
+    if (++index == capacity()) index = 0;
+  }
+  assert(false && "Insertion point not found");
+  return capacity();
+}
+
+template <typename K, typename H>
+size_t hash_set<K, H>::find(K const &key) const {
+  if (capacity() == 0) return 0;
+  size_t index = insertion_point(key, home(key));
+  if (state(index) == EMPTY) return capacity();
+  return index;
+}
+
+template <typename K, typename H>
+bool hash_set<K, H>::is_overloaded() const {
+  if (capacity() == 0) return true;
+  return (float)(size() + deleted_)/(float)capacity() >= OVERLOAD_COEF;
+}
+
+template <typename K, typename H>
+void hash_set<K, H>::reallocate() {
+  size_t capacity = keys_.capacity() == 0 ? 5 : keys_.capacity();
+  // Only drop the deleted elements if they are what overloads the table
+  if ((float)size()/(float)capacity >= OVERLOAD_COEF/2) capacity *= 2;
+  hash_set old;
+  swap(old);
+  hasher_ = old.hasher_;
+  keys_ = vector<K>::reserve(capacity);
+  for (size_t i = 0; i < capacity; ++i) {
+    keys_.push_back(K());
+  }
+  size_t words = (capacity + SLOTS_PER_WORD - 1) / SLOTS_PER_WORD;
+  states_ = vector<uint64_t>::reserve(words);
+  for (size_t i = 0; i < words; ++i) {
+    states_.push_back(0);
+  }
+  for (size_t i = 0; i < old.capacity(); ++i) {
+    if (old.state(i) != LIVE) continue;
+    size_t index = insertion_point(old.keys_[i], home(old.keys_[i]));
+    keys_[index] = std::move(old.keys_[i]);
+    set_state(index, LIVE);
+  }
+  size_ = old.size_;
+}
+
+template <typename K, typename H>
+bool hash_set<K, H>::add(K const &key) {
+  if (is_overloaded()) {
+    reallocate();
+  }
+  size_t index = insertion_point(key, home(key));
+  if (state(index) == LIVE) return false;
+  keys_[index] = key;
+  set_state(index, LIVE);
+  size_++;
+  return true;
+}
+
+template <typename K, typename H>
+bool hash_set<K, H>::remove(K const &key) {
+  size_t index = find(key);
+  if (index == capacity()) return false;
+  keys_[index] = K();
+  set_state(index, DELETED);
+  size_--;
+  deleted_++;
+  return true;
+}
+
+template <typename K, typename H>
+bool hash_set<K, H>::contains(K const &key) const {
+  return find(key) < capacity();
+}
+
+template <typename K, typename H>
+template <size_t G>
+void hash_set<K, H>::contains_batch(K const * keys, size_t n, bool * results) const {
+  if (capacity() == 0) {
+    std::fill(results, results + n, false);
+    return;
+  }
+  size_t homes[G];
+  for (size_t start = 0; start < n; start += G) {
+    size_t count = std::min(G, n - start);
+    for (size_t g = 0; g < count; ++g) {
+      homes[g] = home(keys[start + g]);
+      __builtin_prefetch(&keys_[homes[g]]);
+      __builtin_prefetch(&states_[homes[g] / SLOTS_PER_WORD]);
+    }
+    for (size_t g = 0; g < count; ++g) {
+      size_t index = insertion_point(keys[start + g], homes[g]);
+      results[start + g] = state(index) == LIVE;
+    }
+  }
+}
+
+template <typename K, typename H>
+template <typename F>
+void hash_set<K, H>::for_each(F f) const {
+  for (size_t i = 0; i < capacity(); ++i) {
+    if (state(i) == LIVE) f(keys_[i]);
+  }
+}
+
+}  // namespace gtl
@@ -0,0 +1,141 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <ostream>
+#include "vector.h"
+
+namespace gtl {
+
+/*
+ * Log-linear histogram of non-negative integer values (HdrHistogram style).
+ *
+ * Values below 64 get a bucket each. Above that every power of two range is
+ * split into 32 linear buckets, so any value is known within ~3% with a fixed
+ * 1920 buckets for the whole 64-bit range.
+ */
+struct latency_histogram {
+  latency_histogram();
+
+  void record(uint64_t value, uint64_t count = 1);
+  void merge(latency_histogram const & other);
+
+  uint64_t count() const;
+  uint64_t min() const;
+  uint64_t max() const;
+  double mean() const;
+  // Smallest bucket bound with at least `fraction` of the values below or in it
+  uint64_t percentile(double fraction) const;
+
+  // Per bucket: upper bound, share of the values up to it and 1/(1-share),
+  // the usual x axis of a latency percentile plot
+  void write(std::ostream & out) const;
+
+private:
+  static const size_t SUB_BITS = 5;
+  static const size_t SUB_COUNT = 1 << SUB_BITS;
+  static const size_t N_BUCKETS = 2 * SUB_COUNT + (64 - SUB_BITS - 1) * SUB_COUNT;
+
+  // Allocated on the first `record`
+  vector<uint64_t> counts_;
+  uint64_t count_;
+  uint64_t min_;
+  uint64_t max_;
+  double sum_;
+
+  static size_t bucket(uint64_t value);
+  static uint64_t upper_bound(size_t bucket);
+};
+
+inline latency_histogram::latency_histogram()
+  : counts_()
+  , count_()
+  , min_(UINT64_MAX)
+  , max_()
+  , sum_()
+{}
+
+inline size_t latency_histogram::bucket(uint64_t value) {
+  if (value < 2 * SUB_COUNT) return value;
+  size_t msb = 63 - __builtin_clzll(value);
+  size_t shift = msb - SUB_BITS;
+  size_t top = value >> shift;
+  return 2 * SUB_COUNT + (shift - 1) * SUB_COUNT + (top - SUB_COUNT);
+}
+
+inline uint64_t latency_histogram::upper_bound(size_t bucket) {
+  if (bucket < 2 * SUB_COUNT) return bucket;
+  size_t shift = (bucket - 2 * SUB_COUNT) / SUB_COUNT + 1;
+  uint64_t top = (bucket - 2 * SUB_COUNT) % SUB_COUNT + SUB_COUNT;
+  return ((top + 1) << shift) - 1;
+}
+
+inline void latency_histogram::record(uint64_t value, uint64_t count) {
+  if (count == 0) return;
+  if (counts_.size() == 0) {
+    counts_ = vector<uint64_t>::reserve(N_BUCKETS);
+    for (size_t i = 0; i < N_BUCKETS; ++i) {
+      counts_.push_back(0);
+    }
+  }
+  counts_[bucket(value)] += count;
+  count_ += count;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += (double)value * count;
+}
+
+inline void latency_histogram::merge(latency_histogram const & other) {
+  if (other.count_ == 0) return;
+  if (counts_.size() == 0) {
+    counts_ = other.counts_;
+  } else {
+    for (size_t i = 0; i < N_BUCKETS; ++i) {
+      counts_[i] += other.counts_[i];
+    }
+  }
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+inline uint64_t latency_histogram::count() const {
+  return count_;
+}
+
+inline uint64_t latency_histogram::min() const {
+  return count_ ? min_ : 0;
+}
+
+inline uint64_t latency_histogram::max() const {
+  return max_;
+}
+
+inline double latency_histogram::mean() const {
+  return count_ ? sum_ / count_ : 0;
+}
+
+inline uint64_t latency_histogram::percentile(double fraction) const {
+  if (count_ == 0) return 0;
+  uint64_t rank = std::max<uint64_t>(1, (uint64_t)(fraction * count_ + 0.5));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) return std::min(upper_bound(i), max_);
+  }
+  return max_;
+}
+
+inline void latency_histogram::write(std::ostream & out) const {
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] == 0) continue;
+    seen += counts_[i];
+    double share = (double)seen / count_;
+    double inverse = seen == count_ ? (double)count_ : 1 / (1 - share);
+    out << std::min(upper_bound(i), max_) << " " << share << " " << inverse << "\n";
+  }
+}
+
+}  // namespace gtl
@@ -0,0 +1,16 @@
+set terminal png enhanced size 900,640 font "arial,14"
+set key inside left top vertical Left reverse noenhanced autotitle nobox
+set logscale x
+set logscale y
+set xlabel "Percentile"
+set ylabel "ns per operation"
+set xtics ("50%%" 2, "90%%" 10, "99%%" 100, "99.9%%" 1000, "99.99%%" 10000)
+set style data steps
+
+set output 'bin/latency_addition.png'
+set title "Latency distribution of additions"
+plot for [i=0:*] 'bin/latency_addition.dat' index i using 3:1 title columnheader(1)
+
+set output 'bin/latency_mixed.png'
+set title "Latency distribution of mixed operations"
+plot for [i=0:*] 'bin/latency_mixed.dat' index i using 3:1 title columnheader(1)
@@ -0,0 +1,235 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <cassert>
+#include <functional>
+#include <utility>
+#include "vector.h"
+#include "hash.h"
+
+namespace gtl {
+
+/*
+ * A cache of at most `capacity` elements, which evicts the least recently
+ * used element to make room for a new one.
+ *
+ * The elements live in an open addressing table with linear probing. The
+ * recency list is threaded through the table: every slot stores the slots of
+ * the previous and next element in use order, so there is no separate list
+ * and no allocation after construction. Removal shifts the rest of the probe
+ * run back instead of leaving a tombstone, as a full cache removes an element
+ * on every miss and tombstones would fill the table.
+ */
+template <typename K, typename V, typename H = default_hash<K>> struct lru_cache {
+  // Called with every evicted element, before it is removed
+  typedef std::function<void(K const &, V const &)> eviction_callback;
+
+  explicit lru_cache(size_t capacity, eviction_callback on_evict = nullptr);
+
+  size_t size() const;
+  size_t capacity() const;
+
+  // Marks the element as the most recently used one, nullptr on a miss
+  V * get(K const & key);
+  // Lookup which leaves the use order as it is
+  V const * peek(K const & key) const;
+  bool contains_key(K const & key) const;
+
+  // Adds or updates the element and marks it as the most recently used one,
+  // true if it was added
+  bool put(K const & key, V const & value);
+  bool remove(K const & key);
+
+  // Calls `f(key, value)` for every element from the most to the least
+  // recently used
+  template <typename F> void for_each(F f) const;
+
+private:
+  static const uint32_t NONE = UINT32_MAX;
+
+  struct Entry {
+    K key;
+    V value;
+    // Slots of the neighbours in the use order
+    uint32_t prev;
+    uint32_t next;
+    bool is_used;
+    stored_hash<cache_hash<K>::value> hash;
+  };
+
+  size_t home(size_t hash) const;
+  size_t find(K const & key) const;
+  void link_front(size_t slot);
+  void unlink(size_t slot);
+  void move(size_t from, size_t to);
+  void erase(size_t slot);
+
+  H hasher_;
+  eviction_callback on_evict_;
+  vector<Entry> table_;
+  size_t mask_;
+  size_t capacity_;
+  size_t size_;
+  // Most and least recently used
+  uint32_t head_;
+  uint32_t tail_;
+};
+
+template <typename K, typename V, typename H>
+lru_cache<K, V, H>::lru_cache(size_t capacity, eviction_callback on_evict)
+  : hasher_()
+  , on_evict_(on_evict)
+  , table_()
+  , mask_()
+  , capacity_(capacity)
+  , size_()
+  , head_(NONE)
+  , tail_(NONE)
+{
+  assert(capacity > 0 && "Empty cache");
+  size_t slots = 2;
+  while ((float)capacity / (float)slots > OVERLOAD_COEF) slots *= 2;
+  assert(slots < NONE && "Too large cache");
+  table_ = vector<Entry>::reserve(slots);
+  for (size_t i = 0; i < slots; ++i) {
+    table_.push_back({K(), V(), NONE, NONE, false, 0});
+  }
+  mask_ = slots - 1;
+}
+
+template <typename K, typename V, typename H>
+size_t lru_cache<K, V, H>::size() const {
+  return size_;
+}
+
+template <typename K, typename V, typename H>
+size_t lru_cache<K, V, H>::capacity() const {
+  return capacity_;
+}
+
+// The table size is a power of two, so the hash is mixed first
+template <typename K, typename V, typename H>
+size_t lru_cache<K, V, H>::home(size_t hash) const {
+  return mix_hash(hash) & mask_;
+}
+
+template <typename K, typename V, typename H>
+size_t lru_cache<K, V, H>::find(K const & key) const {
+  size_t hash = hasher_(key);
+  for (size_t slot = home(hash); table_[slot].is_used; slot = (slot + 1) & mask_) {
+    if (table_[slot].hash.matches(hash) && table_[slot].key == key) return slot;
+  }
+  return NONE;
+}
+
+template <typename K, typename V, typename H>
+void lru_cache<K, V, H>::link_front(size_t slot) {
+  table_[slot].prev = NONE;
+  table_[slot].next = head_;
+  if (head_ != NONE) table_[head_].prev = slot;
+  head_ = slot;
+  if (tail_ == NONE) tail_ = slot;
+}
+
+template <typename K, typename V, typename H>
+void lru_cache<K, V, H>::unlink(size_t slot) {
+  Entry const & entry = table_[slot];
+  if (entry.prev != NONE) table_[entry.prev].next = entry.next;
+  else head_ = entry.next;
+  if (entry.next != NONE) table_[entry.next].prev = entry.prev;
+  else tail_ = entry.prev;
+}
+
+// Moves an element to the empty slot `to`, its neighbours follow it
+template <typename K, typename V, typename H>
+void lru_cache<K, V, H>::move(size_t from, size_t to) {
+  table_[to] = std::move(table_[from]);
+  Entry const & entry = table_[to];
+  if (entry.prev != NONE) table_[entry.prev].next = to;
+  else head_ = to;
+  if (entry.next != NONE) table_[entry.next].prev = to;
+  else tail_ = to;
+}
+
+/*
+ * Backward shift deletion: every later element of the probe run which may
+ * live in the hole (its home slot is not between the hole and itself) moves
+ * there, leaving a new hole behind
+ */
+template <typename K, typename V, typename H>
+void lru_cache<K, V, H>::erase(size_t slot) {
+  unlink(slot);
+  size_t hole = slot;
+  for (size_t i = (slot + 1) & mask_; table_[i].is_used; i = (i + 1) & mask_) {
+    size_t i_home = home(table_[i].hash.get(hasher_, table_[i].key));
+    if (((i - i_home) & mask_) >= ((i - hole) & mask_)) {
+      move(i, hole);
+      hole = i;
+    }
+  }
+  table_[hole] = {K(), V(), NONE, NONE, false, 0};
+  --size_;
+}
+
+template <typename K, typename V, typename H>
+V * lru_cache<K, V, H>::get(K const & key) {
+  size_t slot = find(key);
+  if (slot == NONE) return nullptr;
+  if (slot != head_) {
+    unlink(slot);
+    link_front(slot);
+  }
+  return &table_[slot].value;
+}
+
+template <typename K, typename V, typename H>
+V const * lru_cache<K, V, H>::peek(K const & key) const {
+  size_t slot = find(key);
+  if (slot == NONE) return nullptr;
+  return &table_[slot].value;
+}
+
+template <typename K, typename V, typename H>
+bool lru_cache<K, V, H>::contains_key(K const & key) const {
+  return find(key) != NONE;
+}
+
+template <typename K, typename V, typename H>
+bool lru_cache<K, V, H>::put(K const & key, V const & value) {
+  V * existing = get(key);
+  if (existing) {
+    *existing = value;
+    return false;
+  }
+  if (size_ == capacity_) {
+    if (on_evict_) on_evict_(table_[tail_].key, table_[tail_].value);
+    erase(tail_);
+  }
+  size_t hash = hasher_(key);
+  size_t slot = home(hash);
+  while (table_[slot].is_used) {
+    slot = (slot + 1) & mask_;
+  }
+  table_[slot] = {key, value, NONE, NONE, true, hash};
+  link_front(slot);
+  ++size_;
+  return true;
+}
+
+template <typename K, typename V, typename H>
+bool lru_cache<K, V, H>::remove(K const & key) {
+  size_t slot = find(key);
+  if (slot == NONE) return false;
+  erase(slot);
+  return true;
+}
+
+template <typename K, typename V, typename H>
+template <typename F>
+void lru_cache<K, V, H>::for_each(F f) const {
+  for (uint32_t slot = head_; slot != NONE; slot = table_[slot].next) {
+    f(table_[slot].key, table_[slot].value);
+  }
+}
+
+}  // namespace gtl
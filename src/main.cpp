@@ -1,18 +1,46 @@
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdlib>
 #include <iostream>
 #include <ctime>
+#include <list>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include "vector.h"
 #include "vector_map.h"
 #include "hash_map.h"
 #include "tree_map.h"
+#include "art_map.h"
+#include "bloom_filter.h"
+#include "split_hash_map.h"
+#include "compact_hash_map.h"
+#include "cuckoo_map.h"
+#include "concurrent_hash_map.h"
+#include "static_map.h"
+#include "priority_queue.h"
+#include "lru_cache.h"
+#include "hash_set.h"
+#include "std_map_adapter.h"
 #include "memcheck.h"
+#include "alloc_stats.h"
 #include "test_map.h"
+#include "benchmark.h"
+#include "baseline.h"
+#include "perf_counters.h"
+#include "workload.h"
 
 void vector_reserve() {
+  size_t heap_bytes = alloc_stats::current().live_bytes;
   auto vect = gtl::vector<memcheck>::reserve(3);
   assert(memcheck::get_counter() == 0);
+  assert(alloc_stats::current().live_bytes - heap_bytes == 3 * sizeof(memcheck));
 }
 
 void vector_smoketest() {
@@ -68,12 +96,82 @@ void vector_removal_operations() {
   assert(vect_int[0] == 2);
 }
 
+void vector_shrink_to_fit() {
+  gtl::vector<memcheck> vect;
+  for (size_t i = 0; i < 100; ++i) {
+    vect.push_back(memcheck());
+  }
+  for (size_t i = 0; i < 90; ++i) {
+    vect.pop_back();
+  }
+  vect.shrink_to_fit();
+  assert(vect.capacity() == 10 && vect.size() == 10 && memcheck::get_counter() == 10);
+  for (size_t i = 0; i < 10; ++i) {
+    vect.pop_back();
+  }
+  vect.shrink_to_fit();
+  assert(vect.capacity() == 0 && memcheck::get_counter() == 0);
+  vect.push_back(memcheck());
+  assert(vect.size() == 1);
+}
+
+void vector_bulk_operations() {
+  gtl::vector<memcheck> vect;
+  vect.resize(10);
+  assert(vect.size() == 10 && memcheck::get_counter() == 10);
+  gtl::vector<memcheck> other;
+  other.resize(7);
+  vect.append(other);
+  assert(vect.size() == 17 && vect.capacity() == 20 && memcheck::get_counter() == 24);
+  vect.append(vect);
+  assert(vect.size() == 34 && vect.capacity() == 40 && memcheck::get_counter() == 41);
+  vect.resize(5);
+  assert(vect.size() == 5 && memcheck::get_counter() == 12);
+  other.resize(0);
+  assert(memcheck::get_counter() == 5);
+
+  gtl::vector<int> ints;
+  for (int i = 0; i < 10; ++i) {
+    ints.emplace_back(i);
+  }
+  // Reallocates with the argument still in the old buffer
+  assert(ints.size() == ints.capacity() - 6);
+  while (ints.size() < ints.capacity()) {
+    ints.emplace_back(ints[0]);
+  }
+  ints.emplace_back(ints[ints.size() - 1]);
+  assert(ints[ints.size() - 1] == 0);
+  assert(ints.erase_if([](int x) { return x == 0 || x % 2 == 1; }) == 13);
+  assert(ints.size() == 4);
+  for (size_t i = 0; i < ints.size(); ++i) {
+    assert(ints[i] == int(2 * i + 2));
+  }
+  ints.resize(6, ints[0]);
+  assert(ints.size() == 6 && ints[5] == 2);
+  int values[] = {7, 8, 9};
+  ints.append(values, 3);
+  assert(ints.size() == 9 && ints[8] == 9);
+
+  // Cache line aligned elements stay aligned through reallocations
+  struct alignas(64) line { int value; };
+  gtl::vector<line> lines;
+  for (int i = 0; i < 100; ++i) {
+    lines.push_back({i});
+    assert(reinterpret_cast<uintptr_t>(&lines[0]) % 64 == 0 && lines[0].value == 0);
+  }
+  gtl::vector<line> copy(lines);
+  copy.shrink_to_fit();
+  assert(reinterpret_cast<uintptr_t>(&copy[0]) % 64 == 0 && copy[99].value == 99);
+}
+
 void test_vector() {
   std::cout << "vector" << std::endl;
   vector_smoketest();
   vector_reserve();
   vector_value_semantics();
   vector_removal_operations();
+  vector_shrink_to_fit();
+  vector_bulk_operations();
 }
 
 void test_vector_map() {
@@ -84,18 +182,685 @@ void test_vector_map() {
   test_value.value_semantics();
 }
 
+void test_build_parallel() {
+  // Random keys with duplicates, and strided keys which overflow the regions
+  for (int stride : {0, 1280}) {
+    gtl::vector<std::pair<int, int>> pairs;
+    gtl::hash_map<int, int> expected;
+    for (int i = 0; i < 20000; ++i) {
+      int key = stride ? i * stride : rand() % 10000;
+      pairs.push_back(std::make_pair(key, i));
+      expected.add(key, i);
+    }
+    for (size_t threads : {1, 3, 8}) {
+      auto map = gtl::hash_map<int, int>::build_parallel(&pairs[0], pairs.size(), threads);
+      assert(map.size() == expected.size());
+      expected.for_each([&](int key, int value) { assert(*map.lookup(key) == value); });
+      assert(map.add(-1, 0) && map.remove(-1));
+    }
+  }
+}
+
+void test_hash_map_shrinking() {
+  size_t heap_bytes = alloc_stats::current().live_bytes;
+  gtl::hash_map<int, int> map;
+  for (int i = 0; i < 100000; ++i) {
+    map.add(i, i);
+  }
+  size_t peak_capacity = map.capacity();
+  for (int i = 100; i < 100000; ++i) {
+    map.remove(i);
+  }
+  assert(map.size() == 100 && map.capacity() < peak_capacity / 100);
+  assert(alloc_stats::current().live_bytes - heap_bytes < 100 * sizeof(int) * 2 * 10);
+  for (int i = 0; i < 200; ++i) {
+    assert(map.contains_key(i) == (i < 100));
+  }
+  gtl::hash_map<int, int> grown;
+  for (int i = 0; i < 1000; ++i) {
+    grown.add(i, i);
+  }
+  for (int i = 0; i < 800; ++i) {
+    grown.remove(i);
+  }
+  size_t capacity = grown.capacity();
+  grown.shrink_to_fit();
+  assert(grown.capacity() < capacity && grown.stats().tombstones == 0 && grown.size() == 200);
+
+  // Compaction between random operations keeps the contents
+  gtl::hash_map<int, int> compacted;
+  std::map<int, int> expected;
+  for (int i = 0; i < 50000; ++i) {
+    int key = rand() % 2000;
+    if (rand() % 2) {
+      compacted.add(key, i);
+      expected[key] = i;
+    } else {
+      assert(compacted.remove(key) == bool(expected.erase(key)));
+    }
+    compacted.compact_step(3);
+  }
+  assert(compacted.size() == expected.size());
+  for (auto const & pair : expected) {
+    assert(*compacted.lookup(pair.first) == pair.second);
+  }
+  // A few sweeps over the table remove every tombstone
+  for (size_t slices = 0; compacted.compact_step(100) > 0; ++slices) {
+    assert(slices < compacted.capacity() / 10);
+  }
+  for (auto const & pair : expected) {
+    assert(*compacted.lookup(pair.first) == pair.second);
+  }
+
+  // A bulk removal shrinks the table if it empties it, otherwise it leaves
+  // tombstones like `remove`
+  gtl::hash_map<int, int> swept;
+  for (int i = 0; i < 10000; ++i) {
+    swept.add(i, i);
+  }
+  capacity = swept.capacity();
+  assert(swept.erase_if([](int key, int) { return key % 10 != 0; }) == 9000);
+  assert(swept.capacity() < capacity && swept.stats().tombstones == 0);
+  assert(swept.erase_if([](int key, int) { return key % 20 == 0; }) == 500);
+  assert(swept.stats().tombstones == 0 && swept.size() == 500);
+  for (int i = 0; i < 10000; ++i) {
+    assert(swept.contains_key(i) == (i % 20 == 10));
+  }
+  capacity = swept.capacity();
+  assert(swept.erase_if([](int key, int) { return key % 1000 == 10; }) == 10);
+  assert(swept.capacity() == capacity && swept.stats().tombstones == 10 && swept.size() == 490);
+  for (int i = 0; i < 10000; ++i) {
+    assert(swept.contains_key(i) == (i % 20 == 10 && i % 1000 != 10));
+  }
+}
+
 void test_hash_map() {
   std::cout << "hash_map" << std::endl;
   gtl::smoketest_map< gtl::hash_map<int, int> > test;
   test.smoketest();
   gtl::smoketest_map< gtl::hash_map<int, memcheck> > test_value;
   test_value.value_semantics();
+  gtl::smoketest_map< gtl::hash_map<int, int, gtl::default_hash<int>, true> > test_stats;
+  test_stats.smoketest();
+
+  gtl::hash_map<int, int, gtl::default_hash<int>, true> map;
+  for (int i = 0; i < 1000; ++i) {
+    map.add(i, i);
+  }
+  for (int i = 0; i < 1000; i += 2) {
+    map.remove(i);
+  }
+  gtl::hash_map_stats stats = map.stats();
+  assert(stats.size == 500 && stats.capacity == map.capacity());
+  assert(stats.tombstones == 500);
+  assert(stats.max_probe_length == 0 && stats.probe_histogram[0] == 500);
+  assert(stats.rehashes > 0 && stats.rehash_ns > 0);
+  // Keys sharing the factors of the capacity only have a few home slots
+  gtl::hash_map<int, int> strided;
+  for (int i = 0; i < 1000; ++i) {
+    strided.add(i * 1280, i);
+  }
+  assert(strided.stats().max_probe_length > 100);
+  assert(strided.stats().rehashes == 0);
+  test_build_parallel();
+  test_hash_map_shrinking();
+}
+
+typedef gtl::sentinel_keys<int, INT_MIN, INT_MIN + 1> int_sentinels;
+
+void test_hash_set() {
+  std::cout << "hash_set" << std::endl;
+  gtl::hash_set<int> set;
+  gtl::hash_map<int, int> expected;
+  for (int i = 0; i < 20000; ++i) {
+    int key = rand() % 3000;
+    if (rand() % 3) {
+      assert(set.add(key) == expected.add(key, 0));
+    } else {
+      assert(set.remove(key) == expected.remove(key));
+    }
+    assert(set.size() == expected.size());
+  }
+  gtl::vector<int> keys;
+  for (int key = 0; key < 3100; ++key) {
+    assert(set.contains(key) == expected.contains_key(key));
+    keys.push_back(key);
+  }
+  std::unique_ptr<bool[]> results(new bool[keys.size()]);
+  set.contains_batch(&keys[0], keys.size(), results.get());
+  set.contains_batch<5>(&keys[0], 7, results.get());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    assert(results[i] == expected.contains_key(keys[i]));
+  }
+  size_t n = 0;
+  set.for_each([&](int key) { assert(expected.contains_key(key)); ++n; });
+  assert(n == set.size());
+  gtl::hash_set<int> copy(set);
+  assert(copy.size() == set.size() && copy.contains(keys[0]) == set.contains(keys[0]));
+  gtl::hash_set<int> empty;
+  empty.contains_batch(&keys[0], 1, results.get());
+  assert(!results[0] && !empty.contains(0) && !empty.remove(0));
+
+  gtl::hash_set<std::string> strings;
+  assert(strings.add("a") && !strings.add("a") && strings.contains("a") && !strings.contains("b"));
+
+  size_t heap_bytes = alloc_stats::current().live_bytes;
+  gtl::hash_set<int> small_set;
+  for (int i = 0; i < 10000; ++i) {
+    small_set.add(i);
+  }
+  size_t set_bytes = alloc_stats::current().live_bytes - heap_bytes;
+  gtl::hash_map<int, int> map;
+  for (int i = 0; i < 10000; ++i) {
+    map.add(i, 0);
+  }
+  size_t map_bytes = alloc_stats::current().live_bytes - heap_bytes - set_bytes;
+  assert(small_set.capacity() == map.capacity() && 3 * set_bytes < map_bytes + map_bytes / 10);
+}
+
+void test_split_hash_map() {
+  std::cout << "split_hash_map" << std::endl;
+  gtl::smoketest_map< gtl::split_hash_map<int, int> > test;
+  test.smoketest();
+  gtl::smoketest_map< gtl::split_hash_map<int, memcheck> > test_value;
+  test_value.value_semantics();
+  gtl::smoketest_map< gtl::split_hash_map<int, int, gtl::default_hash<int>, int_sentinels> > test_sentinel;
+  test_sentinel.smoketest();
+
+  // The reserved keys are never found, not even in an empty slot or a
+  // tombstone at their home
+  gtl::split_hash_map<int, int, gtl::default_hash<int>, int_sentinels> map;
+  for (int i = 1000; i < 1500; ++i) {
+    map.add(i, i);
+  }
+  int home = int(gtl::default_hash<int>()(INT_MIN + 1) % map.capacity());
+  bool kept = map.contains_key(home);
+  map.add(home, home);
+  map.remove(home);
+  size_t size = map.size();
+  assert(size == size_t(500 - kept));
+  assert(!map.contains_key(INT_MIN + 1) && !map.lookup(INT_MIN + 1) && !map.remove(INT_MIN + 1));
+  assert(!map.contains_key(INT_MIN) && !map.remove(INT_MIN));
+  assert(map.size() == size);
+}
+
+void test_compact_hash_map() {
+  std::cout << "compact_hash_map" << std::endl;
+  gtl::smoketest_map< gtl::compact_hash_map<int, int> > test;
+  test.smoketest();
+  gtl::smoketest_map< gtl::compact_hash_map<int, memcheck> > test_value;
+  test_value.value_semantics();
+
+  gtl::compact_hash_map<int, int> map;
+  gtl::vector<int> order;
+  for (int i = 0; i < 1000; ++i) {
+    int element = rand();
+    if (map.add(element, i)) order.push_back(element);
+  }
+  assert(map.index_width() == 2);
+  for (size_t i = 0; i < order.size(); i += 2) {
+    map.remove(order[i]);
+  }
+  size_t position = 1;
+  map.for_each([&](int key, int) {
+    assert(key == order[position]);
+    position += 2;
+  });
+  assert(position == order.size() + 1);
+}
+
+void test_cuckoo_map() {
+  std::cout << "cuckoo_map" << std::endl;
+  gtl::smoketest_map< gtl::cuckoo_map<int, int> > test;
+  test.smoketest();
+  gtl::smoketest_map< gtl::cuckoo_map<int, memcheck> > test_value;
+  test_value.value_semantics();
+
+  // The table fills up to the maximum load before it grows
+  gtl::cuckoo_map<int, int> map;
+  std::map<int, int> expected;
+  float peak_load = 0;
+  for (int i = 0; i < 200000; ++i) {
+    int element = rand();
+    assert(map.add(element, i) == expected.insert(std::make_pair(element, i)).second);
+    expected[element] = i;
+    peak_load = std::max(peak_load, (float)map.size() / (float)map.capacity());
+    assert(map.stash_size() <= 8);
+  }
+  assert(peak_load >= 0.9 && peak_load <= gtl::CUCKOO_OVERLOAD_COEF);
+  for (auto const & pair : expected) {
+    assert(*map.lookup(pair.first) == pair.second);
+  }
+  size_t capacity = map.capacity();
+  for (auto const & pair : expected) {
+    assert(map.remove(pair.first));
+  }
+  assert(map.size() == 0 && map.stash_size() == 0 && map.capacity() == capacity);
+
+  // Small buckets fill up long before the maximum load and use the stash
+  gtl::cuckoo_map<int, int, gtl::default_hash<int>, 1> narrow;
+  bool stashed = false;
+  for (int i = 0; i < 20000; ++i) {
+    narrow.add(i, -i);
+    stashed = stashed || narrow.stash_size() > 0;
+  }
+  assert(stashed);
+  for (int i = 0; i < 20000; i += 2) {
+    assert(narrow.remove(i));
+  }
+  for (int i = 0; i < 20000; ++i) {
+    assert(bool(narrow.lookup(i)) == (i % 2 == 1));
+  }
+}
+
+void test_concurrent_hash_map() {
+  std::cout << "concurrent_hash_map" << std::endl;
+  typedef gtl::concurrent_hash_map<int, int> map_type;
+  map_type map;
+  std::map<int, int> expected;
+  {
+    map_type::reader reader(map);
+    for (int i = 0; i < 100000; ++i) {
+      int key = rand() % 5000;
+      if (rand() % 3) {
+        assert(map.add(key, i) == (expected.count(key) == 0));
+        expected[key] = i;
+      } else {
+        assert(map.remove(key) == bool(expected.erase(key)));
+      }
+    }
+    assert(map.size() == expected.size());
+    for (int key = 0; key < 5000; ++key) {
+      int value = -1;
+      int read = -1;
+      bool found = expected.count(key) > 0;
+      assert(map.lookup(key, value) == found && reader.lookup(key, read) == found);
+      assert(!found || (value == expected[key] && read == value));
+    }
+  }
+  size_t visited = 0;
+  map.for_each([&](int key, int value) {
+    assert(expected[key] == value);
+    ++visited;
+  });
+  assert(visited == expected.size());
+  // No reader was in a lookup when the tables were swapped
+  assert(map.reclaim() == 0);
+  for (auto const & pair : expected) {
+    map.remove(pair.first);
+  }
+  assert(map.size() == 0 && map.capacity() <= 10);
+
+  // Readers during growth, shrinking and rehashes see every stable key, and
+  // the churned keys with their values or not at all
+  for (int i = 0; i < 1000; ++i) {
+    map.add(i, 2 * i);
+  }
+  std::atomic<bool> stop(false);
+  gtl::run_parallel(5, [&](size_t t) {
+    if (t == 0) {
+      for (int round = 0; round < 20; ++round) {
+        for (int i = 1000; i < 20000; ++i) {
+          map.add(i, 2 * i);
+          if (i % 3 == 0) map.add(i % 1000, 2 * (i % 1000));
+        }
+        for (int i = 1000; i < 20000; ++i) {
+          assert(map.remove(i));
+        }
+      }
+      stop.store(true);
+      return;
+    }
+    map_type::reader reader(map);
+    while (!stop.load()) {
+      for (int i = 0; i < 20000; ++i) {
+        int value = -1;
+        bool found = reader.lookup(i, value);
+        assert(found ? value == 2 * i : i >= 1000);
+      }
+    }
+  });
+  assert(map.size() == 1000 && map.reclaim() == 0);
+}
+
+void test_string_keys() {
+  std::cout << "hash_map with string keys" << std::endl;
+  gtl::hash_map<std::string, int> map;
+  for (int i = 0; i < 100; ++i) {
+    assert(map.add("key" + std::to_string(i), i));
+  }
+  assert(!map.add("key1", 100));
+  assert(map.size() == 100);
+  assert(*map.lookup(std::string("key1")) == 100);
+  assert(*map.lookup("key2") == 2);
+  std::string buffer = "key3key4";
+  assert(*map.lookup(gtl::string_view(buffer.data() + 4, 4)) == 4);
+  assert(map.contains_key(gtl::string_view("key5")));
+  assert(!map.contains_key("key"));
+  assert(map.remove("key6"));
+  assert(!map.remove(std::string("key6")));
+  assert(map.lookup("key6") == nullptr);
+  assert(map.size() == 99);
+
+  gtl::hash_map<std::string, int> copy(map);
+  for (int i = 0; i < 100; ++i) {
+    assert(copy.contains_key("key" + std::to_string(i)) == (i != 6));
+  }
+}
+
+void test_static_map() {
+  std::cout << "static_map" << std::endl;
+  int keys[] = {3, 1, 4, 1, 5, 9, 2, 6};
+  int values[] = {0, 1, 2, 3, 4, 5, 6, 7};
+  auto map = gtl::static_map<int, int>::build(keys, values, 8);
+  assert(map.size() == 7);
+  assert(*map.lookup(1) == 3);
+  assert(*map.lookup(6) == 7);
+  assert(!map.contains_key(7));
+  gtl::static_map<int, int> empty;
+  assert(!empty.contains_key(1));
+
+  std::string names[] = {"add", "sub", "mul", "div", "jmp", "ret"};
+  auto opcodes = gtl::static_map<std::string, int>::build(names, values, 6);
+  for (int i = 0; i < 6; ++i) {
+    assert(*opcodes.lookup(names[i]) == i);
+  }
+  assert(opcodes.lookup("nop") == nullptr);
 }
 
 void test_tree_map() {
   std::cout << "tree_map" << std::endl;
   gtl::smoketest_map< gtl::tree_map<int, int> > test;
   test.smoketest();
+
+  gtl::tree_map<int, int> map;
+  gtl::vector<int> keys;
+  for (int i = 0; i < 1000; ++i) {
+    map.add(rand() % 2000, i);
+    keys.push_back(rand() % 2000);
+  }
+  gtl::vector<int const *> results;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    results.push_back(nullptr);
+  }
+  map.lookup_batch(&keys[0], keys.size(), &results[0]);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    assert(results[i] == map.lookup(keys[i]));
+  }
+  map.lookup_batch<3>(&keys[0], 2, &results[0]);
+  assert(results[1] == map.lookup(keys[1]));
+  gtl::tree_map<int, int> empty;
+  empty.lookup_batch(&keys[0], 1, &results[0]);
+  assert(results[0] == nullptr);
+
+  assert(empty.min_key() == nullptr);
+  size_t size = map.size();
+  int previous = INT_MIN;
+  while (map.size() > 0) {
+    int min = *map.min_key();
+    assert(min > previous);
+    previous = min;
+    map.delete_min();
+    assert(map.size() == --size);
+    assert(!map.contains_key(min));
+  }
+}
+
+template <typename K>
+void art_map_ordered(K min, K max) {
+  gtl::art_map<K, int> map;
+  std::map<K, int> expected;
+  auto random_key = [&]() {
+    // Dense runs, sparse keys and both ends of the key range
+    switch (rand() % 4) {
+      case 0: return K(rand() % 3000);
+      case 1: return K(uint64_t(rand()) * uint64_t(rand()));
+      case 2: return K(min + rand() % 100);
+      default: return K(max - rand() % 100);
+    }
+  };
+  for (int i = 0; i < 20000; ++i) {
+    K key = random_key();
+    if (rand() % 4) {
+      assert(map.add(key, i) == expected.insert(std::make_pair(key, i)).second);
+      expected[key] = i;
+    } else {
+      assert(map.remove(key) == bool(expected.erase(key)));
+    }
+    assert(map.size() == expected.size());
+  }
+  auto next = expected.begin();
+  map.for_each([&](K key, int value) {
+    assert(next != expected.end() && key == next->first && value == next->second);
+    ++next;
+  });
+  assert(next == expected.end());
+  for (int i = 0; i < 100; ++i) {
+    K from = random_key();
+    K to = rand() % 10 ? random_key() : from;
+    auto in_range = expected.lower_bound(from);
+    map.for_each_in_range(from, to, [&](K key, int) {
+      assert(in_range != expected.end() && key == in_range->first);
+      ++in_range;
+    });
+    assert(to < from || in_range == expected.upper_bound(to));
+  }
+  for (auto const & pair : expected) {
+    assert(map.remove(pair.first));
+  }
+  assert(map.size() == 0 && !map.contains_key(min));
+}
+
+void test_art_map() {
+  std::cout << "art_map" << std::endl;
+  gtl::smoketest_map< gtl::art_map<int, int> > test;
+  test.smoketest();
+  art_map_ordered<int>(INT_MIN, INT_MAX);
+  art_map_ordered<unsigned>(0, UINT_MAX);
+  art_map_ordered<int64_t>(INT64_MIN, INT64_MAX);
+  art_map_ordered<uint16_t>(0, UINT16_MAX);
+
+  // Every node size, growing and shrinking
+  gtl::art_map<int, int> map;
+  for (int i = 0; i < 70000; ++i) {
+    map.add(i, i);
+  }
+  for (int i = 0; i < 70000; i += 2) {
+    map.remove(i);
+  }
+  for (int i = 0; i < 70000; ++i) {
+    assert(map.contains_key(i) == bool(i % 2));
+  }
+}
+
+void test_priority_queue() {
+  std::cout << "priority_queue" << std::endl;
+  gtl::vector<int> values;
+  std::multimap<int, size_t> expected;
+  for (size_t i = 0; i < 1000; ++i) {
+    values.push_back(rand() % 500);
+  }
+  gtl::priority_queue<int> queue;
+  gtl::priority_queue<int, 2> binary;
+  for (size_t i = 0; i < values.size(); ++i) {
+    queue.push(values[i]);
+    binary.push(values[i]);
+    expected.insert(std::make_pair(values[i], i));
+  }
+  auto heapified = gtl::priority_queue<int, 8>::heapify(values);
+  assert(queue.size() == values.size() && heapified.size() == values.size());
+  for (auto const & pair : expected) {
+    assert(queue.top() == pair.first);
+    assert(queue.pop_min() == pair.first);
+    assert(binary.pop_min() == pair.first);
+    assert(heapified.pop_min() == pair.first);
+  }
+  assert(queue.size() == 0);
+
+  // Only the element lifetimes are checked, all memchecks are equal
+  struct equal {
+    bool operator()(memcheck const &, memcheck const &) const { return false; }
+  };
+  gtl::priority_queue<memcheck, 4, equal> checked;
+  for (size_t i = 0; i < 10; ++i) {
+    checked.push(memcheck());
+  }
+  while (checked.size() > 0) {
+    checked.pop_min();
+  }
+  assert(memcheck::get_counter() == 0);
+
+  gtl::indexed_priority_queue<int> indexed;
+  for (size_t id = 0; id < values.size(); id += 2) {
+    indexed.push(id, values[id]);
+  }
+  for (size_t id = 0; id < values.size(); id += 4) {
+    indexed.decrease_key(id, values[id] - 1000);
+    values[id] -= 1000;
+  }
+  assert(indexed.contains(4) && !indexed.contains(3) && !indexed.contains(5000));
+  assert(indexed.priority(4) == values[4]);
+  int previous = INT_MIN;
+  while (indexed.size() > 0) {
+    size_t id = indexed.top();
+    assert(indexed.top_priority() == values[id] && values[id] >= previous);
+    previous = values[id];
+    assert(indexed.pop_min() == id && !indexed.contains(id));
+  }
+  indexed.push(3, 0);
+  assert(indexed.top() == 3);
+}
+
+void test_lru_cache() {
+  std::cout << "lru_cache" << std::endl;
+  // Most recently used first
+  std::list<int> order;
+  std::map<int, int> values;
+  int evicted = -1;
+  gtl::lru_cache<int, int> cache(50, [&](int const & key, int const & value) {
+    assert(key == order.back() && value == values[key]);
+    evicted = key;
+  });
+  auto use = [&](int key) {
+    order.remove(key);
+    order.push_front(key);
+  };
+  for (int i = 0; i < 100000; ++i) {
+    int key = rand() % 200;
+    int op = rand() % 8;
+    if (op < 4) {
+      int * value = cache.get(key);
+      assert(bool(value) == bool(values.count(key)));
+      if (value) {
+        assert(*value == values[key]);
+        use(key);
+      }
+    } else if (op < 7) {
+      bool full = order.size() == 50 && !values.count(key);
+      int expected_evicted = full ? order.back() : -1;
+      evicted = -1;
+      assert(cache.put(key, i) == !values.count(key));
+      assert(evicted == expected_evicted);
+      if (full) {
+        values.erase(order.back());
+        order.pop_back();
+      }
+      values[key] = i;
+      use(key);
+    } else {
+      assert(cache.remove(key) == bool(values.count(key)));
+      values.erase(key);
+      order.remove(key);
+    }
+    assert(cache.size() == order.size());
+  }
+  auto expected = order.begin();
+  cache.for_each([&](int key, int value) {
+    assert(key == *expected++ && value == values[key]);
+    assert(*cache.peek(key) == value);
+  });
+
+  gtl::lru_cache<int, int> no_callback(50);
+  size_t allocations = alloc_stats::current().allocations;
+  for (int i = 0; i < 1000; ++i) {
+    if (!no_callback.get(i % 70)) no_callback.put(i % 70, i);
+  }
+  assert(alloc_stats::current().allocations == allocations);
+
+  gtl::lru_cache<std::string, int> strings(10);
+  for (int i = 0; i < 100; ++i) {
+    strings.put(std::to_string(i % 20), i);
+  }
+  assert(strings.size() == 10 && strings.contains_key("19") && !strings.contains_key("9"));
+}
+
+void test_bloom_filter() {
+  std::cout << "bloom_filter" << std::endl;
+  gtl::bloom_filter<int> filter(1000, 10);
+  for (int i = 0; i < 1000; ++i) {
+    filter.insert(i);
+  }
+  size_t false_positives = 0;
+  for (int i = 0; i < 1000; ++i) {
+    assert(filter.may_contain(i));
+    false_positives += filter.may_contain(i + 1000);
+  }
+  assert(false_positives < 50);
+
+  gtl::smoketest_map< gtl::bloom_map<int, int, gtl::hash_map<int, int>> > test;
+  test.smoketest();
+  gtl::smoketest_map< gtl::bloom_map<int, int, gtl::tree_map<int, int>> > test_tree;
+  test_tree.smoketest();
+}
+
+void test_baseline() {
+  std::cout << "baseline" << std::endl;
+  gtl::vector<double> before, same, slower;
+  for (int i = 0; i < 20; ++i) {
+    double noise = std::rand() % 1000;
+    before.push_back(10000 + noise);
+    same.push_back(10000 + std::rand() % 1000);
+    slower.push_back(12000 + 1.2 * noise);
+  }
+  gtl::sample_comparison c = gtl::compare_samples(before, before, 0.01);
+  assert(c.p_value > 0.99 && c.delta == 0 && c.delta_low < 0 && c.delta_high > 0);
+  c = gtl::compare_samples(before, same, 0.01);
+  assert(c.delta_low < 0.1 && c.delta_high > -0.1);
+  c = gtl::compare_samples(before, slower, 0.01);
+  assert(c.p_value < 1e-6 && c.delta_low < 0.2 + 1e-9 && c.delta_high > 0.2 - 1e-9);
+  // Exact test for few runs: 5 slower runs against 5 are significant at 0.01,
+  // 3 against 3 can not be
+  gtl::vector<double> few_before(before), few_slower(slower);
+  few_before.resize(5);
+  few_slower.resize(5);
+  assert(std::fabs(gtl::smallest_p_value(5, 5) - 2.0 / 252) < 1e-12);
+  assert(gtl::smallest_p_value(3, 3) > 0.01 && gtl::smallest_p_value(1, 20) == 1);
+  c = gtl::compare_samples(few_before, few_slower, 0.01);
+  assert(std::fabs(c.p_value - 2.0 / 252) < 1e-12 && c.delta > 0.1);
+
+  gtl::benchmark_report report;
+  gtl::benchmark_result result("HashMap", "Search/uniform", 1000, 100);
+  result.samples = before;
+  report.results.push_back(result);
+  report.results.push_back(result);
+  gtl::save_baseline(report, "bin/test.baseline");
+  gtl::vector<gtl::benchmark_result> baseline = gtl::load_baseline("bin/test.baseline");
+  assert(baseline.size() == 2 && baseline[1].workload == "Search/uniform" && baseline[1].n_ops == 100);
+  assert(baseline[1].samples.size() == 20 && baseline[1].median() == result.median());
+  std::stringstream out;
+  assert(gtl::compare_report(baseline, report, gtl::comparison_options(), out) == 0);
+  report.results[1].samples = slower;
+  assert(gtl::compare_report(baseline, report, gtl::comparison_options(), out) == 1);
+  // Twice the operations per run in the same time is a speedup
+  report.results[1].samples = before;
+  report.results[1].n_ops = 200;
+  assert(gtl::compare_report(baseline, report, gtl::comparison_options(), out) == 0);
+  assert(out.str().find("faster") != std::string::npos);
+  assert(out.str().find("too few runs") == std::string::npos);
+  report.results[1].samples.resize(1);
+  gtl::compare_report(baseline, report, gtl::comparison_options(), out);
+  assert(out.str().find("1 results have too few runs") != std::string::npos);
+  assert(gtl::load_baseline("bin/missing.baseline").size() == 0);
 }
 
 void map_comparison() {
@@ -105,26 +870,289 @@ void map_comparison() {
   std::cout << "vector_map vs hash_map" << std::endl;
   gtl::map_comparison_test< gtl::vector_map<int, int>, gtl::hash_map<int, int> > test2;
   test2.compare_random_queries();
+  test2.compare_bulk_mutations();
   std::cout << "tree_map vs hash_map" << std::endl;
   gtl::map_comparison_test< gtl::tree_map<int, int>, gtl::hash_map<int, int> > test3;
   test3.compare_random_queries();
+  test3.compare_bulk_mutations();
+  std::cout << "art_map vs hash_map" << std::endl;
+  gtl::map_comparison_test< gtl::art_map<int, int>, gtl::hash_map<int, int> > test_art;
+  test_art.compare_random_queries();
+  test_art.compare_bulk_mutations();
+  std::cout << "bloom_map<tree_map> vs hash_map" << std::endl;
+  gtl::map_comparison_test< gtl::bloom_map<int, int, gtl::tree_map<int, int>>, gtl::hash_map<int, int> > test4;
+  test4.compare_random_queries();
+  std::cout << "split_hash_map vs hash_map" << std::endl;
+  gtl::map_comparison_test< gtl::split_hash_map<int, int, gtl::default_hash<int>, int_sentinels>, gtl::hash_map<int, int> > test5;
+  test5.compare_random_queries();
+  test5.compare_bulk_mutations();
+  std::cout << "compact_hash_map vs hash_map" << std::endl;
+  gtl::map_comparison_test< gtl::compact_hash_map<int, int>, gtl::hash_map<int, int> > test6;
+  test6.compare_random_queries();
+  test6.compare_bulk_mutations();
+  std::cout << "hash_map vs tree_map" << std::endl;
+  gtl::map_comparison_test< gtl::hash_map<int, int>, gtl::tree_map<int, int> > test8;
+  test8.compare_bulk_mutations();
+  std::cout << "cuckoo_map vs hash_map" << std::endl;
+  gtl::map_comparison_test< gtl::cuckoo_map<int, int>, gtl::hash_map<int, int> > test9;
+  test9.compare_random_queries();
+  test9.compare_bulk_mutations();
+  gtl::map_comparison_test< gtl::cuckoo_map<int, int, gtl::default_hash<int>, 2>, gtl::hash_map<int, int> > test10;
+  test10.compare_random_queries();
+  std::cout << "static_map vs hash_map" << std::endl;
+  gtl::map_comparison_test< gtl::static_map<int, int>, gtl::hash_map<int, int> > test7;
+  test7.compare_static_queries();
+}
+
+typedef gtl::std_map_adapter<std::unordered_map<int, int>> std_unordered_map;
+typedef gtl::std_map_adapter<std::map<int, int>> std_map;
+
+void map_benchmarks(gtl::benchmark_report & report, gtl::workload const & w) {
+  // Additions and lookups of a vector_map are linear
+  if (w.spec.size <= 1000) gtl::benchmark<gtl::vector_map<int, int>>(report, "VectorMap", w);
+  gtl::benchmark<gtl::hash_map<int, int, std::hash<int>>>(report, "HashMap", w);
+  gtl::benchmark<gtl::cuckoo_map<int, int, std::hash<int>>>(report, "CuckooMap", w);
+  gtl::benchmark<gtl::tree_map<int, int>>(report, "TreeMap", w);
+  gtl::benchmark<gtl::art_map<int, int>>(report, "ArtMap", w);
+  gtl::benchmark<std_unordered_map>(report, "std::unordered_map", w);
+  gtl::benchmark<std_map>(report, "std::map", w);
+}
+
+void read_scaling_benchmarks(gtl::benchmark_report & report, gtl::workload const & w, size_t max_threads) {
+  if (w.spec.size <= 1000) gtl::read_scaling_benchmark<gtl::vector_map<int, int>>(report, "VectorMap", w, max_threads);
+  gtl::read_scaling_benchmark<gtl::hash_map<int, int, std::hash<int>>>(report, "HashMap", w, max_threads);
+  gtl::read_scaling_benchmark<gtl::cuckoo_map<int, int, std::hash<int>>>(report, "CuckooMap", w, max_threads);
+  gtl::read_scaling_benchmark<gtl::tree_map<int, int>>(report, "TreeMap", w, max_threads);
+  gtl::read_scaling_benchmark<gtl::art_map<int, int>>(report, "ArtMap", w, max_threads);
+  gtl::read_scaling_benchmark<std_unordered_map>(report, "std::unordered_map", w, max_threads);
+  gtl::read_scaling_benchmark<std_map>(report, "std::map", w, max_threads);
+}
+
+// Readers and one writer, so one reader less than `max_threads`
+void concurrent_read_benchmarks(gtl::benchmark_report & report, gtl::workload const & w, size_t max_threads) {
+  gtl::concurrent_read_benchmark<gtl::concurrent_hash_map<int, int, std::hash<int>>>(report, "ConcurrentHashMap", w,
+                                                                                    max_threads);
+  gtl::concurrent_read_benchmark<gtl::rwlock_map<gtl::hash_map<int, int, std::hash<int>>>>(report, "HashMap+rwlock", w,
+                                                                                        max_threads);
+}
+
+void queue_benchmarks(gtl::benchmark_report & report, size_t size) {
+  gtl::queue_benchmark<gtl::priority_queue<uint64_t, 2>>(report, "PriorityQueue/2", size);
+  gtl::queue_benchmark<gtl::priority_queue<uint64_t, 4>>(report, "PriorityQueue/4", size);
+  gtl::queue_benchmark<gtl::priority_queue<uint64_t, 8>>(report, "PriorityQueue/8", size);
+  gtl::heapify_benchmark<gtl::priority_queue<uint64_t, 4>>(report, "PriorityQueue/4", size);
+  gtl::queue_benchmark<gtl::tree_queue<uint64_t>>(report, "TreeMap", size);
+}
+
+void cache_benchmarks(gtl::benchmark_report & report, gtl::workload const & w) {
+  for (size_t capacity : {w.spec.size / 100, w.spec.size / 10}) {
+    gtl::cache_benchmark<gtl::lru_cache<int, int>>(report, "LruCache", w, capacity);
+    gtl::cache_benchmark<gtl::list_lru_cache<int, int>>(report, "HashMap+std::list", w, capacity);
+  }
+}
+
+void set_benchmarks(gtl::benchmark_report & report, gtl::workload const & w) {
+  gtl::benchmark_result sequential = gtl::set_benchmark<gtl::hash_set<int>>(report, "HashSet", w);
+  gtl::batch_contains_benchmark<gtl::hash_set<int>, 16>(report, "HashSet", w, sequential);
+  gtl::set_benchmark<gtl::map_set<gtl::hash_map<int, int>>>(report, "HashMap", w);
+}
+
+void sweep_benchmarks(gtl::benchmark_report & report, gtl::workload const & w) {
+  // Removals from a vector_map search it, the key by key sweep is quadratic
+  if (w.spec.size <= 10000) gtl::sweep_benchmark<gtl::vector_map<int, int>>(report, "VectorMap", w);
+  gtl::sweep_benchmark<gtl::hash_map<int, int>>(report, "HashMap", w);
+  gtl::sweep_benchmark<gtl::compact_hash_map<int, int>>(report, "CompactHashMap", w);
+  gtl::sweep_benchmark<gtl::tree_map<int, int>>(report, "TreeMap", w);
+}
+
+gtl::benchmark_report benchmark(gtl::benchmark_options const & options, gtl::workload_spec const & spec,
+                                size_t max_size, size_t max_threads) {
+  gtl::benchmark_report report(options);
+  // Fewer runs for the large maps, which take long to fill
+  gtl::benchmark_options large_options = options;
+  large_options.runs = std::min<size_t>(options.runs, 5);
+  large_options.warmup_runs = std::min<size_t>(options.warmup_runs, 1);
+  for (size_t size = 100; size <= max_size; size *= 10) {
+    gtl::workload_spec sweep = spec;
+    sweep.distribution = gtl::UNIFORM;
+    sweep.size = size;
+    report.options = size > 10000 ? large_options : options;
+    map_benchmarks(report, gtl::workload(sweep));
+  }
+  report.options = options;
+  std::string suffix = "/" + spec.name();
+  report.write_table("bin/benchmark.dat", {"Addition" + suffix, "Search" + suffix,
+                                           "Search+Add+Delete" + suffix, "Deletion" + suffix}, spec.size);
+  report.write_histograms("bin/latency_addition.dat", "Addition" + suffix, spec.size);
+  report.write_histograms("bin/latency_mixed.dat", "Search+Add+Delete" + suffix, spec.size);
+
+  for (gtl::key_distribution distribution : {gtl::ZIPFIAN, gtl::SEQUENTIAL, gtl::STRIDED, gtl::CLUSTERED}) {
+    gtl::workload_spec skewed = spec;
+    skewed.distribution = distribution;
+    map_benchmarks(report, gtl::workload(skewed));
+  }
+
+  // Concurrent lookups on a small (cache resident) and the largest map
+  for (size_t size : {(size_t)1000, max_size}) {
+    gtl::workload_spec readers = spec;
+    readers.size = size;
+    read_scaling_benchmarks(report, gtl::workload(readers), max_threads);
+    concurrent_read_benchmarks(report, gtl::workload(readers), std::max<size_t>(max_threads - 1, 1));
+  }
+
+  gtl::workload_spec build = spec;
+  build.size = max_size;
+  build.n_ops = 0;
+  report.options = large_options;
+  gtl::build_benchmark<gtl::hash_map<int, int>>(report, "HashMap", gtl::workload(build), max_threads);
+
+  // Trees larger than the last level cache
+  gtl::workload_spec batch = spec;
+  batch.size = max_size;
+  gtl::batch_lookup_benchmark<gtl::tree_map<int, int>>(report, "TreeMap", gtl::workload(batch));
+  report.options = options;
+
+  for (size_t size : {(size_t)1000, max_size}) {
+    report.options = size > 10000 ? large_options : options;
+    queue_benchmarks(report, size);
+  }
+  report.options = options;
+
+  for (size_t size : {(size_t)10000, max_size}) {
+    gtl::workload_spec members = spec;
+    members.size = size;
+    report.options = size > 10000 ? large_options : options;
+    set_benchmarks(report, gtl::workload(members));
+  }
+  report.options = options;
+
+  for (size_t size : {(size_t)10000, max_size}) {
+    gtl::workload_spec expiring = spec;
+    expiring.distribution = gtl::UNIFORM;
+    expiring.size = size;
+    report.options = size > 10000 ? large_options : options;
+    sweep_benchmarks(report, gtl::workload(expiring));
+  }
+  report.options = options;
+
+  // Caches holding 1% and 10% of the keys, all the queries are for keys of
+  // the workload
+  for (double s : {0.8, 0.99, 1.2}) {
+    gtl::workload_spec cached = spec;
+    cached.distribution = gtl::ZIPFIAN;
+    cached.size = 100000;
+    cached.n_ops = 1000000;
+    cached.hit_ratio = 1;
+    cached.zipf_s = s;
+    cache_benchmarks(report, gtl::workload(cached));
+  }
+
+  for (double bits_per_key : {6.0, 10.0, 16.0}) {
+    gtl::bloom_benchmark<gtl::hash_map<int, int>>(report, "HashMap", bits_per_key);
+    gtl::bloom_benchmark<gtl::tree_map<int, int>>(report, "TreeMap", bits_per_key);
+  }
+
+  gtl::large_value_benchmark<gtl::hash_map<int, gtl::payload<64>>, 64>(report, "HashMap");
+  gtl::large_value_benchmark<gtl::split_hash_map<int, gtl::payload<64>>, 64>(report, "SplitHashMap");
+  gtl::large_value_benchmark<gtl::hash_map<int, gtl::payload<256>>, 256>(report, "HashMap");
+  gtl::large_value_benchmark<gtl::split_hash_map<int, gtl::payload<256>>, 256>(report, "SplitHashMap");
+  gtl::large_value_benchmark<
+    gtl::split_hash_map<int, gtl::payload<256>, gtl::default_hash<int>, int_sentinels>, 256>(report, "SplitHashMap(sentinel)");
+
+  gtl::scan_benchmark<gtl::hash_map<int, int>>(report, "HashMap");
+  gtl::scan_benchmark<gtl::compact_hash_map<int, int>>(report, "CompactHashMap");
+
+  gtl::string_benchmark<gtl::hash_map<std::string, int>>(report, "HashMap");
+  gtl::string_benchmark<gtl::hash_map<std::string, int, std::hash<std::string>>>(report, "HashMap(std::hash)");
+  gtl::string_benchmark<gtl::tree_map<std::string, int>>(report, "TreeMap");
+
+  for (size_t n : {16, 256, 4096}) {
+    gtl::lookup_benchmark<gtl::vector_map<int, int>>(report, "VectorMap", n);
+    gtl::lookup_benchmark<gtl::hash_map<int, int>>(report, "HashMap", n);
+    gtl::lookup_benchmark<gtl::static_map<int, int>>(report, "StaticMap", n);
+  }
+
+  report.write_csv("bin/benchmark.csv");
+  report.write_json("bin/benchmark.json");
+  return report;
 }
 
 int main(int argc, char* argv[]) {
   std::srand(std::time(0));
-  // test_vector();
-  // test_vector_map();
-  // test_hash_map();
-  // test_tree_map();
-  // map_comparison();
-
-  std::ofstream f("bin/benchmark.dat");
-  f << "Map Addition Search Search+Add+Delete Deletion\n";
-  std::cout << "benchmark vector map" << std::endl;
-  f << "VectorMap" << " " << gtl::benchmark<gtl::vector_map<int, int>>();
-  std::cout << "benchmark hash map" << std::endl;
-  f << "HashMap" << " " << gtl::benchmark<gtl::hash_map<int, int, std::hash<int>>>();
-  std::cout << "benchmark tree map" << std::endl;
-  f << "TreeMap" << " " << gtl::benchmark<gtl::tree_map<int, int>>();
+  if (argc > 1 && std::string(argv[1]) == "benchmark") {
+    // ./bin/test benchmark [--runs N] [--warmup N] [--latency-runs N] [--max-size N] [--hit-ratio X] [--zipf S]
+    //                      [--perf 1] [--threads N] [--save NAME] [--compare NAME] [--alpha X] [--threshold X]
+    gtl::benchmark_options options;
+    gtl::perf_counters counters;
+    gtl::workload_spec spec;
+    size_t max_size = 1000000;
+    size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    gtl::comparison_options comparison;
+    std::string save, compare;
+    for (int i = 2; i + 1 < argc; i += 2) {
+      std::string option = argv[i];
+      size_t value = std::strtoul(argv[i + 1], nullptr, 10);
+      if (option == "--runs") options.runs = std::max<size_t>(value, 1);
+      else if (option == "--warmup") options.warmup_runs = value;
+      else if (option == "--latency-runs") options.latency_runs = value;
+      else if (option == "--max-size") max_size = std::min<size_t>(value, 100000000);
+      else if (option == "--hit-ratio") spec.hit_ratio = std::strtod(argv[i + 1], nullptr);
+      else if (option == "--zipf") spec.zipf_s = std::strtod(argv[i + 1], nullptr);
+      else if (option == "--perf" && value) options.counters = &counters;
+      else if (option == "--threads") max_threads = std::max<size_t>(value, 1);
+      else if (option == "--save") save = argv[i + 1];
+      else if (option == "--compare") compare = argv[i + 1];
+      else if (option == "--alpha") comparison.alpha = std::strtod(argv[i + 1], nullptr);
+      else if (option == "--threshold") comparison.threshold = std::strtod(argv[i + 1], nullptr);
+    }
+    if (!(spec.zipf_s >= 0 && std::isfinite(spec.zipf_s))) {
+      std::cout << "--zipf has to be a number of 0 or more" << std::endl;
+      return 2;
+    }
+    if (max_size < 100) {
+      std::cout << "--max-size has to be 100 or more" << std::endl;
+      return 2;
+    }
+    if (!(spec.hit_ratio >= 0 && spec.hit_ratio <= 1)) {
+      std::cout << "--hit-ratio has to be a number from 0 to 1" << std::endl;
+      return 2;
+    }
+    if (options.counters && !counters.available()) {
+      std::cout << "Hardware counters are not available, running without them" << std::endl;
+      options.counters = nullptr;
+    }
+    // The same keys in every run, so that the results match those of a baseline
+    std::srand((unsigned)spec.seed);
+    gtl::vector<gtl::benchmark_result> baseline;
+    if (!compare.empty()) {
+      baseline = gtl::load_baseline("bin/" + compare + ".baseline");
+      if (baseline.size() == 0) {
+        std::cout << "No baseline in bin/" << compare << ".baseline" << std::endl;
+        return 2;
+      }
+    }
+    gtl::benchmark_report report = benchmark(options, spec, max_size, max_threads);
+    if (!save.empty()) gtl::save_baseline(report, "bin/" + save + ".baseline");
+    if (compare.empty()) return 0;
+    std::cout << std::endl << "Compared with bin/" << compare << ".baseline" << std::endl;
+    return gtl::compare_report(baseline, report, comparison, std::cout) ? 1 : 0;
+  }
+  test_vector();
+  test_vector_map();
+  test_hash_map();
+  test_hash_set();
+  test_split_hash_map();
+  test_compact_hash_map();
+  test_cuckoo_map();
+  test_concurrent_hash_map();
+  test_string_keys();
+  test_static_map();
+  test_tree_map();
+  test_art_map();
+  test_priority_queue();
+  test_lru_cache();
+  test_bloom_filter();
+  test_baseline();
+  map_comparison();
   return 0;
 }
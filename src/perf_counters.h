@@ -0,0 +1,144 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include "vector.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+namespace gtl {
+
+/*
+ * Hardware counters of the calling thread (instructions, cache, TLB and
+ * branch misses) and page faults, read through Linux `perf_event_open` and
+ * accumulated over `start`/`stop` pairs.
+ *
+ * Counters the kernel or the CPU refuse (e.g. with a restrictive
+ * perf_event_paranoid, in a VM, or on another OS) are left out, so
+ * `available()` may be false and `start`/`stop` do nothing.
+ */
+struct perf_counters {
+  perf_counters();
+  ~perf_counters();
+  perf_counters(perf_counters const &) = delete;
+  perf_counters & operator=(perf_counters const &) = delete;
+
+  bool available() const;
+  size_t size() const;
+  std::string const & name(size_t i) const;
+  // Sum over the `start`/`stop` pairs since the last `reset`, scaled up if
+  // the kernel had to multiplex the counters
+  double value(size_t i) const;
+
+  void reset();
+  void start();
+  void stop();
+
+private:
+  struct counter {
+    std::string name;
+    int fd;
+    double total;
+  };
+
+  vector<counter> counters_;
+
+  void open(std::string const & name, uint32_t type, uint64_t config);
+};
+
+#ifdef __linux__
+
+inline perf_counters::perf_counters()
+  : counters_()
+{
+  uint64_t cache_read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  open("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  open("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  open("branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+  open("l1d_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache_read_miss);
+  open("llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  open("dtlb_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cache_read_miss);
+  // Software event, usually available even where the hardware ones are not
+  open("page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+}
+
+inline perf_counters::~perf_counters() {
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    close(counters_[i].fd);
+  }
+}
+
+inline void perf_counters::open(std::string const & name, uint32_t type, uint64_t config) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  if (fd < 0) return;
+  counters_.push_back({name, fd, 0});
+}
+
+inline void perf_counters::start() {
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    ioctl(counters_[i].fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counters_[i].fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+inline void perf_counters::stop() {
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    ioctl(counters_[i].fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    // Value, time enabled, time running
+    uint64_t data[3];
+    if (read(counters_[i].fd, data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+    counters_[i].total += (double)data[0] * data[1] / data[2];
+  }
+}
+
+#else
+
+inline perf_counters::perf_counters() : counters_() {}
+inline perf_counters::~perf_counters() {}
+inline void perf_counters::open(std::string const &, uint32_t, uint64_t) {}
+inline void perf_counters::start() {}
+inline void perf_counters::stop() {}
+
+#endif
+
+inline bool perf_counters::available() const {
+  return counters_.size() > 0;
+}
+
+inline size_t perf_counters::size() const {
+  return counters_.size();
+}
+
+inline std::string const & perf_counters::name(size_t i) const {
+  return counters_[i].name;
+}
+
+inline double perf_counters::value(size_t i) const {
+  return counters_[i].total;
+}
+
+inline void perf_counters::reset() {
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    counters_[i].total = 0;
+  }
+}
+
+}  // namespace gtl
@@ -0,0 +1,269 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <utility>
+#include "vector.h"
+
+namespace gtl {
+
+/*
+ * A min priority queue as an implicit `D`-ary heap in a `vector`.
+ *
+ * The children of `i` are `D * i + 1` to `D * i + D`, so with the default
+ * `D = 4` and small elements all the children of a node share a cache line and
+ * the heap is half as deep as a binary one. Elements are only moved inside
+ * the buffer: once the buffer has grown to the largest size, `push` and
+ * `pop_min` do not allocate.
+ */
+template <typename T, size_t D = 4, typename Less = std::less<T>> struct priority_queue {
+  priority_queue();
+  // O(n) bottom-up construction from a batch of elements in any order
+  static priority_queue heapify(vector<T> values);
+
+  size_t size() const;
+
+  void push(T const & value);
+  T const & top() const;
+  T pop_min();
+
+private:
+  static_assert(D >= 2, "A heap node needs at least two children");
+
+  void sift_up(size_t index);
+  void sift_down(size_t index);
+
+  Less less_;
+  vector<T> heap_;
+};
+
+template <typename T, size_t D, typename Less>
+priority_queue<T, D, Less>::priority_queue()
+  : less_()
+  , heap_()
+{}
+
+template <typename T, size_t D, typename Less>
+priority_queue<T, D, Less> priority_queue<T, D, Less>::heapify(vector<T> values) {
+  priority_queue queue;
+  queue.heap_.swap(values);
+  size_t n = queue.heap_.size();
+  if (n < 2) return queue;
+  for (size_t parent = (n - 2) / D + 1; parent > 0; --parent) {
+    queue.sift_down(parent - 1);
+  }
+  return queue;
+}
+
+template <typename T, size_t D, typename Less>
+size_t priority_queue<T, D, Less>::size() const {
+  return heap_.size();
+}
+
+template <typename T, size_t D, typename Less>
+void priority_queue<T, D, Less>::push(T const & value) {
+  heap_.push_back(value);
+  sift_up(heap_.size() - 1);
+}
+
+template <typename T, size_t D, typename Less>
+T const & priority_queue<T, D, Less>::top() const {
+  assert(heap_.size() != 0 && "Empty queue");
+  return heap_[0];
+}
+
+template <typename T, size_t D, typename Less>
+T priority_queue<T, D, Less>::pop_min() {
+  assert(heap_.size() != 0 && "Empty queue");
+  T last = heap_.pop_back();
+  if (heap_.size() == 0) return last;
+  T result = std::move(heap_[0]);
+  heap_[0] = std::move(last);
+  sift_down(0);
+  return result;
+}
+
+// Moves the hole up instead of swapping, every level writes one element
+template <typename T, size_t D, typename Less>
+void priority_queue<T, D, Less>::sift_up(size_t index) {
+  T value = std::move(heap_[index]);
+  while (index > 0) {
+    size_t parent = (index - 1) / D;
+    if (!less_(value, heap_[parent])) break;
+    heap_[index] = std::move(heap_[parent]);
+    index = parent;
+  }
+  heap_[index] = std::move(value);
+}
+
+template <typename T, size_t D, typename Less>
+void priority_queue<T, D, Less>::sift_down(size_t index) {
+  size_t n = heap_.size();
+  T value = std::move(heap_[index]);
+  while (true) {
+    size_t first = D * index + 1;
+    if (first >= n) break;
+    size_t last = std::min(first + D, n);
+    size_t best = first;
+    for (size_t child = first + 1; child < last; ++child) {
+      if (less_(heap_[child], heap_[best])) best = child;
+    }
+    if (!less_(heap_[best], value)) break;
+    heap_[index] = std::move(heap_[best]);
+    index = best;
+  }
+  heap_[index] = std::move(value);
+}
+
+/*
+ * A `D`-ary min heap of ids `0 .. n - 1` ordered by a priority per id, which
+ * also keeps the heap position of every id, so the priority of a queued id can
+ * be lowered with `decrease_key` in O(log n) (e.g. for Dijkstra, or to move a
+ * timer earlier). The positions take a `size_t` per id up to the largest id
+ * pushed.
+ */
+template <typename P, size_t D = 4, typename Less = std::less<P>> struct indexed_priority_queue {
+  indexed_priority_queue();
+
+  size_t size() const;
+
+  bool contains(size_t id) const;
+  P const & priority(size_t id) const;
+
+  void push(size_t id, P const & priority);
+  // Lowers the priority of a queued `id`, `priority` must not be greater
+  void decrease_key(size_t id, P const & priority);
+  size_t top() const;
+  P const & top_priority() const;
+  size_t pop_min();
+
+private:
+  static_assert(D >= 2, "A heap node needs at least two children");
+  static const size_t NOT_QUEUED = SIZE_MAX;
+
+  // Priorities are kept in the heap so that sifting never leaves it
+  struct entry {
+    P priority;
+    size_t id;
+  };
+
+  void place(size_t index, entry && e);
+  void sift_up(size_t index);
+  void sift_down(size_t index);
+
+  Less less_;
+  vector<entry> heap_;
+  vector<size_t> positions_;
+};
+
+template <typename P, size_t D, typename Less>
+const size_t indexed_priority_queue<P, D, Less>::NOT_QUEUED;
+
+template <typename P, size_t D, typename Less>
+indexed_priority_queue<P, D, Less>::indexed_priority_queue()
+  : less_()
+  , heap_()
+  , positions_()
+{}
+
+template <typename P, size_t D, typename Less>
+size_t indexed_priority_queue<P, D, Less>::size() const {
+  return heap_.size();
+}
+
+template <typename P, size_t D, typename Less>
+bool indexed_priority_queue<P, D, Less>::contains(size_t id) const {
+  return id < positions_.size() && positions_[id] != NOT_QUEUED;
+}
+
+template <typename P, size_t D, typename Less>
+P const & indexed_priority_queue<P, D, Less>::priority(size_t id) const {
+  assert(contains(id) && "Id is not queued");
+  return heap_[positions_[id]].priority;
+}
+
+template <typename P, size_t D, typename Less>
+void indexed_priority_queue<P, D, Less>::push(size_t id, P const & priority) {
+  assert(!contains(id) && "Id is already queued");
+  while (positions_.size() <= id) {
+    positions_.push_back(NOT_QUEUED);
+  }
+  positions_[id] = heap_.size();
+  heap_.push_back({priority, id});
+  sift_up(heap_.size() - 1);
+}
+
+template <typename P, size_t D, typename Less>
+void indexed_priority_queue<P, D, Less>::decrease_key(size_t id, P const & priority) {
+  assert(contains(id) && "Id is not queued");
+  size_t index = positions_[id];
+  assert(!less_(heap_[index].priority, priority) && "Priority can only decrease");
+  heap_[index].priority = priority;
+  sift_up(index);
+}
+
+template <typename P, size_t D, typename Less>
+size_t indexed_priority_queue<P, D, Less>::top() const {
+  assert(heap_.size() != 0 && "Empty queue");
+  return heap_[0].id;
+}
+
+template <typename P, size_t D, typename Less>
+P const & indexed_priority_queue<P, D, Less>::top_priority() const {
+  assert(heap_.size() != 0 && "Empty queue");
+  return heap_[0].priority;
+}
+
+template <typename P, size_t D, typename Less>
+size_t indexed_priority_queue<P, D, Less>::pop_min() {
+  assert(heap_.size() != 0 && "Empty queue");
+  size_t id = heap_[0].id;
+  positions_[id] = NOT_QUEUED;
+  entry last = heap_.pop_back();
+  if (heap_.size() != 0) {
+    place(0, std::move(last));
+    sift_down(0);
+  }
+  return id;
+}
+
+template <typename P, size_t D, typename Less>
+void indexed_priority_queue<P, D, Less>::place(size_t index, entry && e) {
+  positions_[e.id] = index;
+  heap_[index] = std::move(e);
+}
+
+template <typename P, size_t D, typename Less>
+void indexed_priority_queue<P, D, Less>::sift_up(size_t index) {
+  entry e = std::move(heap_[index]);
+  while (index > 0) {
+    size_t parent = (index - 1) / D;
+    if (!less_(e.priority, heap_[parent].priority)) break;
+    place(index, std::move(heap_[parent]));
+    index = parent;
+  }
+  place(index, std::move(e));
+}
+
+template <typename P, size_t D, typename Less>
+void indexed_priority_queue<P, D, Less>::sift_down(size_t index) {
+  size_t n = heap_.size();
+  entry e = std::move(heap_[index]);
+  while (true) {
+    size_t first = D * index + 1;
+    if (first >= n) break;
+    size_t last = std::min(first + D, n);
+    size_t best = first;
+    for (size_t child = first + 1; child < last; ++child) {
+      if (less_(heap_[child].priority, heap_[best].priority)) best = child;
+    }
+    if (!less_(heap_[best].priority, e.priority)) break;
+    place(index, std::move(heap_[best]));
+    index = best;
+  }
+  place(index, std::move(e));
+}
+
+}  // namespace gtl
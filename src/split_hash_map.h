@@ -0,0 +1,326 @@
+#pragma once
+#include "vector.h"
+#include "hash.h"
+#include <utility>
+
+namespace gtl {
+  /*
+   * Key slot policies for split_hash_map.
+   *
+   * `flagged_keys` stores a state byte next to every key. `sentinel_keys`
+   * reserves two key values to mark empty and deleted slots, so a slot is just
+   * the key itself; these two values can not be added to the map.
+   */
+  template <typename K> struct flagged_keys {
+    struct slot {
+      K key;
+      unsigned char state;
+    };
+    enum { EMPTY, DELETED, LIVE };
+
+    static slot empty() { return {K(), EMPTY}; }
+    static slot deleted() { return {K(), DELETED}; }
+    static slot live(K const & key) { return {key, LIVE}; }
+
+    static bool is_empty(slot const & s) { return s.state == EMPTY; }
+    static bool is_live(slot const & s) { return s.state == LIVE; }
+    static bool matches(slot const & s, K const & key) { return s.state == LIVE && s.key == key; }
+    static K const & key(slot const & s) { return s.key; }
+  };
+
+  template <typename K, K EMPTY_KEY, K DELETED_KEY> struct sentinel_keys {
+    typedef K slot;
+
+    static slot empty() { return EMPTY_KEY; }
+    static slot deleted() { return DELETED_KEY; }
+    static slot live(K const & key) {
+      assert(key != EMPTY_KEY && key != DELETED_KEY && "Reserved key");
+      return key;
+    }
+
+    static bool is_empty(slot const & s) { return s == EMPTY_KEY; }
+    static bool is_live(slot const & s) { return s != EMPTY_KEY && s != DELETED_KEY; }
+    static bool matches(slot const & s, K const & key) { return s == key && is_live(s); }
+    static K const & key(slot const & s) { return s; }
+  };
+
+  /*
+   * Hash table with open addressing and linear probing, which keeps keys and
+   * values in two parallel arrays.
+   *
+   * Probing only reads the key array, a value is read after its key is
+   * found. With large values many more slots fit in a cache line than in
+   * `hash_map`, whose entries hold the key and the value together.
+   */
+  template <typename K, typename V, typename H = default_hash<K>, typename S = flagged_keys<K>>
+  struct split_hash_map {
+    split_hash_map();
+    split_hash_map(split_hash_map const &other);
+    split_hash_map(split_hash_map &&other);
+
+    void swap(split_hash_map &other);
+    split_hash_map &operator=(split_hash_map other);
+
+    size_t size() const;
+    size_t capacity() const;
+
+    bool add(K const &key, V const &value);
+    bool remove(K const &key);
+
+    V const* lookup(K const &key) const;
+    V * lookup(K const &key);
+
+    bool contains_key(K const &key) const;
+
+    // Calls `f(key, value)` for every element
+    template <typename F> void for_each(F f) const;
+
+    // Removes the elements for which `pred(key, value)` is true in one pass,
+    // returns their number
+    template <typename P> size_t erase_if(P pred);
+    // Adds the `n` pairs like `add` in order, the table grows at most once
+    size_t insert(std::pair<K, V> const * pairs, size_t n);
+    // Adds every element of `other`, its values replace those of equal keys
+    size_t merge(split_hash_map const & other);
+
+    void trace() const;
+  private:
+    typedef typename S::slot Slot;
+
+    H hasher_;
+    vector<Slot> keys_;
+    vector<V> values_;
+
+    size_t hash(K const & key, size_t capacity) const;
+    size_t find(K const & key) const;
+    bool is_overloaded() const;
+    void reallocate();
+    void rehash(size_t capacity);
+    // Rehashes once so that `n` more elements fit below the maximum load
+    void reserve_more(size_t n);
+    size_t insertion_point(vector<Slot> const & keys, K const &key) const;
+
+    size_t size_;
+    // Number of slots taken by deleted elements
+    size_t deleted_;
+  };
+
+
+template <typename K, typename V, typename H, typename S>
+split_hash_map<K, V, H, S>::split_hash_map()
+  : hasher_()
+  , keys_()
+  , values_()
+  , size_()
+  , deleted_()
+{
+}
+
+template <typename K, typename V, typename H, typename S>
+void split_hash_map<K, V, H, S>::swap(split_hash_map &other) {
+  std::swap(hasher_, other.hasher_);
+  std::swap(keys_, other.keys_);
+  std::swap(values_, other.values_);
+  std::swap(size_, other.size_);
+  std::swap(deleted_, other.deleted_);
+}
+
+template <typename K, typename V, typename H, typename S>
+split_hash_map<K, V, H, S>::split_hash_map(split_hash_map const &other)
+  : hasher_(other.hasher_)
+  , keys_(other.keys_)
+  , values_(other.values_)
+  , size_(other.size_)
+  , deleted_(other.deleted_)
+{}
+
+template <typename K, typename V, typename H, typename S>
+split_hash_map<K, V, H, S>::split_hash_map(split_hash_map && other)
+  : hasher_()
+  , keys_()
+  , values_()
+  , size_()
+  , deleted_()
+{
+  swap(other);
+}
+
+template <typename K, typename V, typename H, typename S>
+split_hash_map<K, V, H, S> & split_hash_map<K, V, H, S>::operator=(split_hash_map other) {
+  swap(other);
+  return *this;
+}
+
+template <typename K, typename V, typename H, typename S>
+size_t split_hash_map<K, V, H, S>::size() const {
+  return size_;
+}
+
+template <typename K, typename V, typename H, typename S>
+size_t split_hash_map<K, V, H, S>::capacity() const {
+  return keys_.capacity();
+}
+
+template <typename K, typename V, typename H, typename S>
+size_t split_hash_map<K, V, H, S>::hash(K const &key, size_t capacity) const {
+  if (capacity == 0) return 0;
+  return hasher_(key) % capacity;
+}
+
+template <typename K, typename V, typename H, typename S>
+size_t split_hash_map<K, V, H, S>::insertion_point(vector<Slot> const & keys, K const &key) const {
+  size_t initial_hash = hash(key, keys.capacity());
+  for (size_t i = initial_hash; i < keys.capacity() + initial_hash; ++i) {
+    size_t ind = i % keys.capacity();
+    if (S::is_empty(keys[ind]) || S::matches(keys[ind], key)) return ind;
+  }
+  assert(false && "Insertion point not found");
+  return keys.capacity();
+}
+
+template <typename K, typename V, typename H, typename S>
+size_t split_hash_map<K, V, H, S>::find(K const &key) const {
+  if (capacity() == 0) return 0;
+  size_t insertion_index = insertion_point(keys_, key);
+  if (S::is_empty(keys_[insertion_index])) return capacity();
+  return insertion_index;
+}
+
+template <typename K, typename V, typename H, typename S>
+void split_hash_map<K, V, H, S>::reallocate() {
+  size_t capacity = keys_.capacity() == 0 ? 5 : keys_.capacity();
+  // Only drop the deleted elements if they are what overloads the table
+  if ((float)size()/(float)capacity >= OVERLOAD_COEF/2) capacity *= 2;
+  rehash(capacity);
+}
+
+template <typename K, typename V, typename H, typename S>
+void split_hash_map<K, V, H, S>::rehash(size_t capacity) {
+  vector<Slot> new_keys = vector<Slot>::reserve(capacity);
+  vector<V> new_values = vector<V>::reserve(capacity);
+  for (size_t i = 0; i < capacity; ++i) {
+    new_keys.push_back(S::empty());
+    new_values.push_back(V());
+  }
+  for (size_t i = 0; i < keys_.capacity(); ++i) {
+    if (S::is_live(keys_[i])) {
+      size_t ind = insertion_point(new_keys, S::key(keys_[i]));
+      new_keys[ind] = keys_[i];
+      new_values[ind] = std::move(values_[i]);
+    }
+  }
+  keys_ = std::move(new_keys);
+  values_ = std::move(new_values);
+  deleted_ = 0;
+}
+
+template <typename K, typename V, typename H, typename S>
+void split_hash_map<K, V, H, S>::reserve_more(size_t n) {
+  if (capacity() != 0 && (float)(size() + deleted_ + n)/(float)capacity() < OVERLOAD_COEF) return;
+  size_t capacity = keys_.capacity() == 0 ? 5 : keys_.capacity();
+  while ((float)(size() + n)/(float)capacity >= OVERLOAD_COEF) capacity *= 2;
+  rehash(capacity);
+}
+
+template <typename K, typename V, typename H, typename S>
+bool split_hash_map<K, V, H, S>::add(K const &key, V const &value) {
+  if (is_overloaded()) {
+    reallocate();
+  }
+  size_t ind = insertion_point(keys_, key);
+  bool result = S::is_empty(keys_[ind]);
+  keys_[ind] = S::live(key);
+  values_[ind] = value;
+  if (result) size_++;
+  return result;
+}
+
+template <typename K, typename V, typename H, typename S>
+bool split_hash_map<K, V, H, S>::is_overloaded() const {
+  if (capacity() == 0) return true;
+  return (float)(size() + deleted_)/(float)capacity() >= OVERLOAD_COEF;
+}
+
+template <typename K, typename V, typename H, typename S>
+bool split_hash_map<K, V, H, S>::remove(K const &key) {
+  size_t index = find(key);
+  if (index == capacity()) return false;
+  keys_[index] = S::deleted();
+  values_[index] = V();
+  size_--;
+  deleted_++;
+  return true;
+}
+
+template <typename K, typename V, typename H, typename S>
+bool split_hash_map<K, V, H, S>::contains_key(K const &key) const {
+  return find(key) < capacity();
+}
+
+template <typename K, typename V, typename H, typename S>
+V const * split_hash_map<K, V, H, S>::lookup(K const &key) const {
+  size_t index = find(key);
+  if (index == capacity()) return nullptr;
+  return &values_[index];
+}
+
+template <typename K, typename V, typename H, typename S>
+V * split_hash_map<K, V, H, S>::lookup(K const &key) {
+  return const_cast<V *>(static_cast<const split_hash_map<K, V, H, S> *>(this)->lookup(key));
+}
+
+template <typename K, typename V, typename H, typename S>
+template <typename F>
+void split_hash_map<K, V, H, S>::for_each(F f) const {
+  for (size_t i = 0; i < keys_.capacity(); ++i) {
+    if (S::is_live(keys_[i])) f(S::key(keys_[i]), values_[i]);
+  }
+}
+
+template <typename K, typename V, typename H, typename S>
+template <typename P>
+size_t split_hash_map<K, V, H, S>::erase_if(P pred) {
+  size_t removed = 0;
+  for (size_t i = 0; i < keys_.capacity(); ++i) {
+    if (!S::is_live(keys_[i]) || !pred(S::key(keys_[i]), values_[i])) continue;
+    keys_[i] = S::deleted();
+    values_[i] = V();
+    ++removed;
+  }
+  size_ -= removed;
+  deleted_ += removed;
+  return removed;
+}
+
+template <typename K, typename V, typename H, typename S>
+size_t split_hash_map<K, V, H, S>::insert(std::pair<K, V> const * pairs, size_t n) {
+  reserve_more(n);
+  size_t added = 0;
+  for (size_t i = 0; i < n; ++i) {
+    added += add(pairs[i].first, pairs[i].second);
+  }
+  return added;
+}
+
+template <typename K, typename V, typename H, typename S>
+size_t split_hash_map<K, V, H, S>::merge(split_hash_map const & other) {
+  reserve_more(other.size());
+  size_t added = 0;
+  other.for_each([&](K const & key, V const & value) { added += add(key, value); });
+  return added;
+}
+
+template <typename K, typename V, typename H, typename S>
+void split_hash_map<K, V, H, S>::trace() const {
+  std::cout << "Capacity is " << keys_.capacity() << ", size is " << size() << std::endl;
+  std::cout << "Elements:" << std::endl;
+  for (size_t i = 0; i < keys_.capacity(); ++i) {
+    if (S::is_live(keys_[i])) {
+      std::cout << S::key(keys_[i]) << ": " << values_[i] << std::endl;
+    } else {
+      std::cout << "<empty> " << !S::is_empty(keys_[i]) << std::endl;
+    }
+  }
+}
+
+}  // namespace gtl
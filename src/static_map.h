@@ -0,0 +1,260 @@
+#pragma once
+#include "vector.h"
+#include "hash.h"
+#include "hash_map.h"
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+
+namespace gtl {
+  /*
+   * Read-only map over a fixed set of keys, built once with a minimal perfect
+   * hash function (hash and displace, see PTHash / CHD).
+   *
+   * Keys are hashed into buckets of a few keys each. For every bucket the
+   * build searches for a "pilot" value which moves all its keys to slots not
+   * yet taken. There are exactly as many slots as keys, so a lookup is one
+   * hash, one pilot read, one slot read and one key compare, with no probing.
+   */
+  template <typename K, typename V, typename H = default_hash<K>> struct static_map {
+    static_map();
+
+    // Duplicate keys keep the last value, as a sequence of `add` would
+    static static_map build(K const * keys, V const * values, size_t n);
+
+    size_t size() const;
+    size_t capacity() const;
+
+    V const* lookup(K const &key) const;
+    V * lookup(K const &key);
+
+    bool contains_key(K const &key) const;
+
+    // Calls `f(key, value)` for every element
+    template <typename F> void for_each(F f) const;
+
+    void trace() const;
+  private:
+    struct Entry {
+        K key;
+        V value;
+    };
+
+    static const size_t KEYS_PER_BUCKET = 4;
+    static const size_t MAX_SEEDS = 100;
+
+    H hasher_;
+    uint64_t seed_;
+    // Mixed pilot of every bucket
+    vector<uint64_t> pilots_;
+    vector<Entry> entries_;
+
+    uint64_t hash(K const & key) const;
+    size_t bucket(uint64_t hash) const;
+    size_t slot(uint64_t hash, uint64_t pilot) const;
+    size_t find(K const & key) const;
+    bool place(vector<K> const & keys, vector<size_t> & slots);
+  };
+
+
+template <typename K, typename V, typename H>
+static_map<K, V, H>::static_map()
+  : hasher_()
+  , seed_()
+  , pilots_()
+  , entries_()
+{}
+
+template <typename K, typename V, typename H>
+size_t static_map<K, V, H>::size() const {
+  return entries_.size();
+}
+
+template <typename K, typename V, typename H>
+size_t static_map<K, V, H>::capacity() const {
+  return entries_.size();
+}
+
+template <typename K, typename V, typename H>
+uint64_t static_map<K, V, H>::hash(K const &key) const {
+  return mix_hash(hasher_(key) ^ seed_);
+}
+
+template <typename K, typename V, typename H>
+size_t static_map<K, V, H>::bucket(uint64_t hash) const {
+  return static_cast<size_t>(((hash >> 32) * pilots_.size()) >> 32);
+}
+
+template <typename K, typename V, typename H>
+size_t static_map<K, V, H>::slot(uint64_t hash, uint64_t pilot) const {
+  return mix_hash(hash ^ pilot) % entries_.size();
+}
+
+template <typename K, typename V, typename H>
+size_t static_map<K, V, H>::find(K const &key) const {
+  if (entries_.size() == 0) return 0;
+  uint64_t h = hash(key);
+  size_t ind = slot(h, pilots_[bucket(h)]);
+  if (entries_[ind].key == key) return ind;
+  return entries_.size();
+}
+
+template <typename K, typename V, typename H>
+bool static_map<K, V, H>::place(vector<K> const & keys, vector<size_t> & slots) {
+  size_t n = keys.size();
+  size_t n_buckets = pilots_.size();
+  vector<uint64_t> hashes = vector<uint64_t>::reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    hashes.push_back(hash(keys[i]));
+  }
+
+  // Bucket members, grouped by bucket
+  vector<size_t> bucket_start = vector<size_t>::reserve(n_buckets + 1);
+  for (size_t i = 0; i <= n_buckets; ++i) {
+    bucket_start.push_back(0);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    ++bucket_start[bucket(hashes[i]) + 1];
+  }
+  for (size_t i = 1; i <= n_buckets; ++i) {
+    bucket_start[i] += bucket_start[i - 1];
+  }
+  vector<size_t> members = vector<size_t>::reserve(n);
+  vector<size_t> fill = vector<size_t>::reserve(n_buckets);
+  for (size_t i = 0; i < n; ++i) {
+    members.push_back(0);
+  }
+  for (size_t i = 0; i < n_buckets; ++i) {
+    fill.push_back(bucket_start[i]);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    members[fill[bucket(hashes[i])]++] = i;
+  }
+
+  // Largest buckets are the hardest to place, so they go first
+  vector<size_t> order = vector<size_t>::reserve(n_buckets);
+  for (size_t i = 0; i < n_buckets; ++i) {
+    order.push_back(i);
+  }
+  std::stable_sort(&order[0], &order[0] + n_buckets, [&](size_t a, size_t b) {
+    return bucket_start[a + 1] - bucket_start[a] > bucket_start[b + 1] - bucket_start[b];
+  });
+
+  vector<bool> taken = vector<bool>::reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    taken.push_back(false);
+  }
+  size_t max_attempts = 100 * n + 1000;
+  for (size_t i = 0; i < n_buckets; ++i) {
+    size_t b = order[i];
+    size_t begin = bucket_start[b];
+    size_t end = bucket_start[b + 1];
+    if (begin == end) break;
+    bool placed = false;
+    for (uint64_t pilot = 0; pilot < max_attempts && !placed; ++pilot) {
+      uint64_t mixed_pilot = mix_hash(pilot);
+      placed = true;
+      for (size_t j = begin; j < end; ++j) {
+        size_t s = slot(hashes[members[j]], mixed_pilot);
+        // Also rejects keys of the same bucket colliding with each other
+        for (size_t k = begin; k < j && placed; ++k) {
+          placed = slots[members[k]] != s;
+        }
+        if (!placed || taken[s]) {
+          placed = false;
+          break;
+        }
+        slots[members[j]] = s;
+      }
+      if (placed) {
+        pilots_[b] = mixed_pilot;
+        for (size_t j = begin; j < end; ++j) {
+          taken[slots[members[j]]] = true;
+        }
+      }
+    }
+    if (!placed) return false;
+  }
+  return true;
+}
+
+template <typename K, typename V, typename H>
+static_map<K, V, H> static_map<K, V, H>::build(K const * keys, V const * values, size_t n) {
+  // Later duplicates overwrite earlier ones
+  hash_map<K, size_t, H> last_index;
+  for (size_t i = 0; i < n; ++i) {
+    last_index.add(keys[i], i);
+  }
+  vector<K> unique_keys = vector<K>::reserve(last_index.size());
+  vector<size_t> indices = vector<size_t>::reserve(last_index.size());
+  for (size_t i = 0; i < n; ++i) {
+    if (*last_index.lookup(keys[i]) == i) {
+      unique_keys.push_back(keys[i]);
+      indices.push_back(i);
+    }
+  }
+
+  static_map map;
+  size_t n_keys = unique_keys.size();
+  if (n_keys == 0) return map;
+  size_t n_buckets = n_keys / KEYS_PER_BUCKET + 1;
+  vector<size_t> slots = vector<size_t>::reserve(n_keys);
+  for (size_t i = 0; i < n_keys; ++i) {
+    slots.push_back(0);
+  }
+  for (size_t i = 0; i < n_keys; ++i) {
+    map.entries_.push_back({unique_keys[i], values[indices[i]]});
+  }
+
+  for (uint64_t seed = 0; seed < MAX_SEEDS; ++seed) {
+    map.seed_ = mix_hash(seed + 1);
+    map.pilots_ = vector<uint64_t>::reserve(n_buckets);
+    for (size_t i = 0; i < n_buckets; ++i) {
+      map.pilots_.push_back(0);
+    }
+    if (map.place(unique_keys, slots)) {
+      for (size_t i = 0; i < n_keys; ++i) {
+        map.entries_[slots[i]] = {unique_keys[i], values[indices[i]]};
+      }
+      return map;
+    }
+  }
+  assert(false && "Perfect hash function not found");
+  return static_map();
+}
+
+template <typename K, typename V, typename H>
+bool static_map<K, V, H>::contains_key(K const &key) const {
+  return find(key) < entries_.size();
+}
+
+template <typename K, typename V, typename H>
+V const * static_map<K, V, H>::lookup(K const &key) const {
+  size_t index = find(key);
+  if (index == entries_.size()) return nullptr;
+  return &entries_[index].value;
+}
+
+template <typename K, typename V, typename H>
+V * static_map<K, V, H>::lookup(K const &key) {
+  return const_cast<V *>(static_cast<const static_map<K, V, H> *>(this)->lookup(key));
+}
+
+template <typename K, typename V, typename H>
+template <typename F>
+void static_map<K, V, H>::for_each(F f) const {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    f(entries_[i].key, entries_[i].value);
+  }
+}
+
+template <typename K, typename V, typename H>
+void static_map<K, V, H>::trace() const {
+  std::cout << "Size is " << size() << ", buckets " << pilots_.size() << std::endl;
+  std::cout << "Elements:" << std::endl;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    std::cout << entries_[i].key << ": " << entries_[i].value << std::endl;
+  }
+}
+
+}  // namespace gtl
@@ -0,0 +1,53 @@
+#pragma once
+#include <stddef.h>
+#include <iostream>
+#include <utility>
+
+namespace gtl {
+  /*
+   * Gives a standard library map (std::map, std::unordered_map) the interface
+   * of the gtl maps, so it can be benchmarked and tested next to them
+   */
+  template <typename M> struct std_map_adapter {
+    typedef typename M::key_type K;
+    typedef typename M::mapped_type V;
+
+    size_t size() const { return map_.size(); }
+    size_t capacity() const { return map_.size(); }
+
+    bool add(K const &key, V const &value) {
+      std::pair<typename M::iterator, bool> result = map_.insert(std::make_pair(key, value));
+      if (!result.second) result.first->second = value;
+      return result.second;
+    }
+
+    bool remove(K const &key) { return map_.erase(key) > 0; }
+
+    V const * lookup(K const &key) const {
+      typename M::const_iterator it = map_.find(key);
+      return it == map_.end() ? nullptr : &it->second;
+    }
+
+    V * lookup(K const &key) {
+      typename M::iterator it = map_.find(key);
+      return it == map_.end() ? nullptr : &it->second;
+    }
+
+    bool contains_key(K const &key) const { return map_.find(key) != map_.end(); }
+
+    template <typename F> void for_each(F f) const {
+      for (typename M::const_iterator it = map_.begin(); it != map_.end(); ++it) {
+        f(it->first, it->second);
+      }
+    }
+
+    void trace() const {
+      std::cout << "Size is " << size() << std::endl;
+      for_each([](K const &key, V const &value) { std::cout << key << ": " << value << std::endl; });
+    }
+
+  private:
+    M map_;
+  };
+
+}  // namespace gtl
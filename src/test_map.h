@@ -4,6 +4,9 @@
 #include <cstdlib>
 #include <ctime>
 #include <climits>
+#include <string>
+#include <utility>
+#include "vector.h"
 
 namespace gtl {
 
@@ -44,7 +47,7 @@ void smoketest_map<T>::smoketest() {
 template <typename T>
 void smoketest_map<T>::search() {
   T map;
-  int MAX = 10;
+  size_t MAX = 10;
   for (size_t i = 0; i < MAX*MAX; ++i) {
     int element = rand() % MAX;
     map.add(element, element);
@@ -93,13 +96,17 @@ void smoketest_map<T>::value_semantics() {
  */
 template <typename T, typename U> struct map_comparison_test {
   void compare_random_queries();
+  // `insert`, `merge` and `erase_if`, then single operations on the result
+  void compare_bulk_mutations();
+  // For read-only maps `T`, built with `T::build` from the contents of `U`
+  void compare_static_queries();
 };
 
 template <typename T, typename U>
 void map_comparison_test<T, U>::compare_random_queries() {
   T map1;
   U map2;
-  int MAX = 1000;
+  size_t MAX = 1000;
   for (size_t i = 0; i < MAX*MAX; ++i) {
     int element = rand() % MAX;
     assert(map1.add(element, element) == map2.add(element, element));
@@ -120,79 +127,73 @@ void map_comparison_test<T, U>::compare_random_queries() {
   }
 }
 
-/*
- *  Benchmarking for map operations
- */
-size_t max_number = 8000;
-size_t n_operations = 1000;
-
-template <typename T> struct addition
-{
-  void operator() (T & map) {
-    for (size_t i = 0; i < 14*n_operations; ++i) {
-      map.add(rand() % max_number, 0);
-    }
+template <typename T, typename U>
+void map_comparison_test<T, U>::compare_bulk_mutations() {
+  T map1;
+  U map2;
+  size_t MAX = 1000;
+  vector<std::pair<int, int>> pairs;
+  for (size_t i = 0; i < MAX; ++i) {
+    pairs.push_back(std::make_pair(rand() % MAX, int(i)));
   }
-};
-
-template <typename T> struct deletion
-{
-  void operator() (T & map) {
-    for (size_t i = 0; i < 14*n_operations; ++i) {
-      map.remove(rand() % max_number);
-    }
+  assert(map1.insert(&pairs[0], pairs.size()) == map2.insert(&pairs[0], pairs.size()));
+  T other1;
+  U other2;
+  for (size_t i = 0; i < MAX/2; ++i) {
+    int element = rand() % (MAX*2);
+    other1.add(element, -element);
+    other2.add(element, -element);
   }
-};
-
-template <typename T> struct search
-{
-  void operator() (T const & map) {
-    for (size_t i = 0; i < 14*n_operations; ++i) {
-      map.contains_key(rand() % max_number);
-    }
+  assert(map1.merge(other1) == map2.merge(other2));
+  for (size_t i = 0; i < MAX/10; ++i) {
+    int element = rand() % (MAX*2);
+    assert(map1.remove(element) == map2.remove(element));
   }
-};
-
-template <typename T> struct mixed
-{
-  void operator() (T & map) {
-    for (size_t i = 0; i < 10*n_operations; ++i) {
-      map.lookup(rand() % max_number);
-    }
-    for (size_t i = 0; i < 3*n_operations; ++i) {
-      int el = rand() % max_number;
-      map.add(el, 0);
-    }
-    for (size_t i = 0; i < n_operations; ++i) {
-      int el = rand() % max_number;
-      map.remove(el);
-    }
+  assert(map1.erase_if([](int, int) { return false; }) == 0);
+  auto is_odd = [](int key, int value) { return (key + value) % 2 != 0; };
+  assert(map1.erase_if(is_odd) == map2.erase_if(is_odd));
+  assert(map1.size() == map2.size());
+  map2.for_each([&](int key, int value) {
+    assert(!is_odd(key, value) && *map1.lookup(key) == value);
+  });
+  for (size_t i = 0; i < MAX; ++i) {
+    int element = rand() % (MAX*2);
+    assert(map1.add(element, element) == map2.add(element, element));
+    element = rand() % (MAX*2);
+    assert(map1.remove(element) == map2.remove(element));
   }
-};
+  assert(map1.erase_if([](int, int) { return true; }) == map2.size());
+  assert(map1.size() == 0);
+}
 
 template <typename T, typename U>
-clock_t benchmark_operation(T & map) {
-  U op;
-  size_t n_runs = 100;
-  clock_t min_time = LONG_MAX;
-  for (size_t i = 0; i < n_runs; ++i) {
-    clock_t start_time = std::clock();
-    op(map);
-    clock_t end_time = std::clock();
-    clock_t t = (end_time - start_time) % CLOCKS_PER_SEC;
-    if (t < min_time) min_time = t;
+void map_comparison_test<T, U>::compare_static_queries() {
+  U map2;
+  size_t MAX = 1000;
+  for (size_t i = 0; i < MAX; ++i) {
+    int element = rand() % MAX;
+    map2.add(element, element);
+    map2.add(element, element*2);
+  }
+  for (size_t i = 0; i < MAX/2; ++i) {
+    map2.remove(rand() % MAX);
+  }
+  vector<int> keys;
+  vector<int> values;
+  map2.for_each([&](int key, int value) {
+    keys.push_back(key);
+    values.push_back(value);
+  });
+  T map1 = T::build(&keys[0], &values[0], keys.size());
+  assert(map1.size() == map2.size());
+  for (size_t i = 0; i < MAX*2; ++i) {
+    int element = rand() % (MAX*2);
+    if (bool(map1.lookup(element))) {
+      assert(*map1.lookup(element) == *map2.lookup(element));
+    } else {
+      assert(map1.lookup(element) == map2.lookup(element));
+    }
+    assert(map1.contains_key(element) == map2.contains_key(element));
   }
-  return min_time;
-}
-
-template <typename T>
-std::string benchmark() {
-  T map;
-  return
-    std::to_string(benchmark_operation<T, addition<T>>(map)) + " " +
-    std::to_string(benchmark_operation<T, search<T>>(map)) + " " +
-    std::to_string(benchmark_operation<T, mixed<T>>(map)) + " " +
-    std::to_string(benchmark_operation<T, deletion<T>>(map)) + " " +
-    "\n";
 }
 }
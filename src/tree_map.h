@@ -1,6 +1,9 @@
+#pragma once
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <utility>
+#include "vector.h"
 
 namespace gtl {
   /*
@@ -17,9 +20,11 @@ namespace gtl {
     size_t size() const;
     size_t capacity() const;
 
-    bool add(K key, V value);
+    bool add(K const & key, V const & value);
     void trace() const;
 
+    // Smallest key, nullptr if the map is empty
+    K const * min_key() const;
     void delete_min();
     bool remove(K const & key);
 
@@ -27,6 +32,28 @@ namespace gtl {
     V * lookup(K const &key);
 
     bool contains_key(K const &key) const;
+
+    /*
+     * `results[i] = lookup(keys[i])` for `n` keys, running `G` lookups at a
+     * time: every step of a lookup prefetches the next node and moves on to
+     * another lookup, so the cache misses of the `G` lookups overlap.
+     */
+    template <size_t G = 16> void lookup_batch(K const * keys, size_t n, V const ** results) const;
+
+    // Calls `f(key, value)` for every element in the key order
+    template <typename F> void for_each(F f) const;
+
+    /*
+     * Removes the elements for which `pred(key, value)` is true in one ordered
+     * pass, which unlinks every node, then builds a balanced tree of the
+     * nodes left, in O(size) overall. Returns the number of removed elements.
+     */
+    template <typename P> size_t erase_if(P pred);
+    // Adds the `n` pairs like `add` in order
+    size_t insert(std::pair<K, V> const * pairs, size_t n);
+    // Adds every element of `other`, its values replace those of equal keys
+    size_t merge(tree_map const & other);
+
     // A debug representation, suitable for displaying with http://www.graphviz.org
     std::string dot_graph(std::string name) const;
 
@@ -43,6 +70,7 @@ namespace gtl {
       void flip_colors();
 
       std::string dot_graph() const;
+      template <typename F> void for_each(F & f) const;
 
       K key;
       V value;
@@ -51,16 +79,25 @@ namespace gtl {
       Node * right;
     };
 
-    Node * add(Node * node, K key, V value, bool & result);
+    // Height of a red-black tree is at most 2 log2(size)
+    static const size_t MAX_DEPTH = 128;
+
     bool is_red(Node * node);
     Node * fix_up(Node * node);
-    Node * delete_min(Node * node);
-    Node * remove(Node * node, K const & key, bool & result);
+    // Links from the root down to the changed node are pushed to `path`, to
+    // be fixed up bottom-up by `fix_up_path`
+    void delete_min(Node ** link, Node ** path[], size_t & depth);
+    void fix_up_path(Node ** path[], size_t depth);
     Node * move_red_left(Node * node);
     Node * move_red_right(Node * node);
-    Node * get(Node * node, K const & key) const;
     Node * get(K const & key) const;
     Node * min(Node * node) const;
+    // Unlinks the nodes under `node`, deleting those matching `pred` and
+    // appending the others to `kept` in the key order
+    template <typename P> static size_t sweep(Node * node, P & pred, vector<Node *> & kept);
+    // A tree of black height `height` of the `n` sorted nodes, which have to
+    // number from 2^height - 1 to 3^height - 1
+    static Node * build(Node * const * nodes, size_t n, size_t height);
     Node * root_;
     size_t size_;
   };
@@ -96,6 +133,14 @@ std::string tree_map<K, V>::Node::dot_graph() const {
   return result.str();
 }
 
+template <typename K, typename V>
+template <typename F>
+void tree_map<K, V>::Node::for_each(F & f) const {
+  if (left) left->for_each(f);
+  f(key, value);
+  if (right) right->for_each(f);
+}
+
 template <typename K, typename V>
 auto tree_map<K, V>::Node::rotate_left() -> Node * {
   Node * x = right;
@@ -149,17 +194,11 @@ auto tree_map<K, V>::fix_up(Node * node) -> Node * {
 }
 
 template <typename K, typename V>
-typename tree_map<K, V>::Node * tree_map<K, V>::add(Node * node, K key, V value, bool & result) {
-  if (!node) {
-    result = true;
-    return new Node(key, value);
+void tree_map<K, V>::fix_up_path(Node ** path[], size_t depth) {
+  while (depth > 0) {
+    --depth;
+    *path[depth] = fix_up(*path[depth]);
   }
-
-  if (key == node->key) node->value = value;
-  else if (key < node->key) node->left = add(node->left, key, value, result);
-  else node->right = add(node->right, key, value, result);
-
-  return fix_up(node);
 }
 
 template <typename K, typename V>
@@ -182,71 +221,111 @@ std::string tree_map<K, V>::dot_graph(std::string name) const {
   return result + "labelloc=\"t\";\nlabel=\"" + name + "\";}";
 }
 
+/*
+ * Top-down search for the key, which updates an existing key in place. A new
+ * node is linked in at the bottom and the path is fixed up on the way back.
+ */
 template <typename K, typename V>
-bool tree_map<K, V>::add(K key, V value) {
-  bool result = false;
-  root_ = add(root_, key, value, result);
+bool tree_map<K, V>::add(K const & key, V const & value) {
+  Node ** path[MAX_DEPTH];
+  size_t depth = 0;
+  Node ** link = &root_;
+  while (Node * node = *link) {
+    if (key == node->key) {
+      node->value = value;
+      return false;
+    }
+    path[depth++] = link;
+    link = key < node->key ? &node->left : &node->right;
+  }
+  *link = new Node(key, value);
+  fix_up_path(path, depth);
   root_->is_red = false;
-  if (result) ++size_;
-  return result;
+  ++size_;
+  return true;
 }
 
+/*
+ * Top-down deletion: on the way down the transformations of the recursive
+ * version keep a red node at the current level, the path is fixed up bottom-up
+ * afterwards.
+ */
 template <typename K, typename V>
 bool tree_map<K, V>::remove(K const & key) {
-  bool result = true;
-  root_ = remove(root_, key, result);
-  if (root_) root_->is_red = false;
-  if (result) --size_;
-  return result;
-}
-
-template <typename K, typename V>
-void tree_map<K, V>::delete_min() {
-  root_ = delete_min(root_);
-  if (root_) root_->is_red = false;
-}
-
-template <typename K, typename V>
-auto tree_map<K, V>::remove(Node * node, K const & key, bool & result) -> Node * {
-  if (!node) {
-    result = false;
-    return nullptr;
-  }
-  if (key < node->key) {
-    if (!is_red(node->left) && (!node->left || !is_red(node->left->left))) node = move_red_left(node);
-    node->left = remove(node->left, key, result);
-  } else {
+  if (!get(key)) return false;
+  Node ** path[MAX_DEPTH];
+  size_t depth = 0;
+  Node ** link = &root_;
+  while (true) {
+    Node * node = *link;
+    if (key < node->key) {
+      if (!is_red(node->left) && (!node->left || !is_red(node->left->left))) node = move_red_left(node);
+      *link = node;
+      path[depth++] = link;
+      link = &node->left;
+      continue;
+    }
     if (is_red(node->left)) node = node->rotate_right();
+    *link = node;
     if (key == node->key && !node->right) {
-      Node * temp = node->left;
+      *link = node->left;
       node->left = nullptr;
       delete node;
-      return temp;
+      break;
     }
     if (!is_red(node->right) && (!node->right || !is_red(node->right->left))) node = move_red_right(node);
+    *link = node;
+    path[depth++] = link;
     if (key == node->key) {
       Node * min_right = min(node->right);
       node->value = min_right->value;
       node->key = min_right->key;
-      node->right = delete_min(node->right);
-    } else {
-      node->right = remove(node->right, key, result);
+      delete_min(&node->right, path, depth);
+      break;
     }
+    link = &node->right;
   }
-  return fix_up(node);
+  fix_up_path(path, depth);
+  if (root_) root_->is_red = false;
+  --size_;
+  return true;
 }
 
 template <typename K, typename V>
-auto tree_map<K, V>::get(Node * node, K const & key) const -> Node * {
-  if (!node) return nullptr;
-  if (node->key == key) return node;
-  if (key < node->key) return get(node->left, key);
-  return get(node->right, key);
+void tree_map<K, V>::delete_min() {
+  if (!root_) return;
+  Node ** path[MAX_DEPTH];
+  size_t depth = 0;
+  delete_min(&root_, path, depth);
+  fix_up_path(path, depth);
+  if (root_) root_->is_red = false;
+  --size_;
+}
+
+template <typename K, typename V>
+void tree_map<K, V>::delete_min(Node ** link, Node ** path[], size_t & depth) {
+  while (true) {
+    Node * node = *link;
+    if (!node->left) {
+      *link = node->right;
+      node->right = nullptr;
+      delete node;
+      return;
+    }
+    if (!is_red(node->left) && !is_red(node->left->left)) node = move_red_left(node);
+    *link = node;
+    path[depth++] = link;
+    link = &node->left;
+  }
 }
 
 template <typename K, typename V>
 auto tree_map<K, V>::get(K const & key) const -> Node * {
-  return get(root_, key);
+  Node * node = root_;
+  while (node && !(node->key == key)) {
+    node = key < node->key ? node->left : node->right;
+  }
+  return node;
 }
 
 template <typename K, typename V>
@@ -257,8 +336,7 @@ bool tree_map<K, V>::contains_key(K const & key) const {
 template <typename K, typename V>
 V const * tree_map<K, V>::lookup(K const &key) const {
   Node * result = get(key);
-  if (result) return &get(key)->value;
-  return nullptr;
+  return result ? &result->value : nullptr;
 }
 
 template <typename K, typename V>
@@ -266,11 +344,142 @@ V * tree_map<K, V>::lookup(K const &key) {
   return const_cast<V *>(static_cast<const tree_map<K, V> *>(this)->lookup(key));
 }
 
+template <typename K, typename V>
+template <size_t G>
+void tree_map<K, V>::lookup_batch(K const * keys, size_t n, V const ** results) const {
+  // Lookup of `keys[index]`, currently at `node`
+  struct cursor {
+    Node const * node;
+    size_t index;
+  };
+  cursor cursors[G];
+  size_t next = 0;
+  size_t active = 0;
+  for (size_t g = 0; g < G; ++g) {
+    cursors[g] = {root_, next < n ? next++ : n};
+    if (cursors[g].index < n) ++active;
+  }
+  while (active > 0) {
+    for (size_t g = 0; g < G; ++g) {
+      cursor & c = cursors[g];
+      if (c.index == n) continue;
+      Node const * node = c.node;
+      K const & key = keys[c.index];
+      if (node && !(node->key == key)) {
+        c.node = key < node->key ? node->left : node->right;
+        __builtin_prefetch(c.node);
+        continue;
+      }
+      results[c.index] = node ? &node->value : nullptr;
+      if (next < n) {
+        c = {root_, next++};
+      } else {
+        c.index = n;
+        --active;
+      }
+    }
+  }
+}
+
+template <typename K, typename V>
+template <typename F>
+void tree_map<K, V>::for_each(F f) const {
+  if (root_) root_->for_each(f);
+}
+
+template <typename K, typename V>
+template <typename P>
+size_t tree_map<K, V>::sweep(Node * node, P & pred, vector<Node *> & kept) {
+  if (!node) return 0;
+  Node * left = node->left;
+  Node * right = node->right;
+  node->left = node->right = nullptr;
+  size_t removed = sweep(left, pred, kept);
+  if (pred(static_cast<K const &>(node->key), static_cast<V const &>(node->value))) {
+    delete node;
+    ++removed;
+  } else {
+    kept.push_back(node);
+  }
+  return removed + sweep(right, pred, kept);
+}
+
+/*
+ * Builds the 2-3 tree the left leaning red-black tree stands for: a 2-node is
+ * a black node, a 3-node a black node with a red left child. The children of
+ * a node share the keys under it evenly, a 3-node is used where 2-nodes can
+ * not hold them all.
+ */
+template <typename K, typename V>
+auto tree_map<K, V>::build(Node * const * nodes, size_t n, size_t height) -> Node * {
+  if (height == 0) return nullptr;
+  size_t most = 1;
+  for (size_t i = 1; i < height; ++i) {
+    most *= 3;
+  }
+  // Up to 2 * 3^(height-1) - 1 keys fit a 2-node
+  if (n < 2 * most) {
+    size_t left = n / 2;
+    Node * node = nodes[left];
+    node->is_red = false;
+    node->left = build(nodes, left, height - 1);
+    node->right = build(nodes + left + 1, n - left - 1, height - 1);
+    return node;
+  }
+  size_t rest = n - 2;
+  size_t first = rest / 3 + (rest % 3 > 0);
+  size_t second = rest / 3 + (rest % 3 > 1);
+  Node * red = nodes[first];
+  Node * node = nodes[first + second + 1];
+  red->is_red = true;
+  red->left = build(nodes, first, height - 1);
+  red->right = build(nodes + first + 1, second, height - 1);
+  node->is_red = false;
+  node->left = red;
+  node->right = build(nodes + first + second + 2, rest - first - second, height - 1);
+  return node;
+}
+
+template <typename K, typename V>
+template <typename P>
+size_t tree_map<K, V>::erase_if(P pred) {
+  vector<Node *> kept = vector<Node *>::reserve(size_);
+  size_t removed = sweep(root_, pred, kept);
+  size_t height = 0;
+  while ((size_t(2) << height) - 1 <= kept.size()) ++height;
+  root_ = kept.size() ? build(&kept[0], kept.size(), height) : nullptr;
+  size_ = kept.size();
+  return removed;
+}
+
+template <typename K, typename V>
+size_t tree_map<K, V>::insert(std::pair<K, V> const * pairs, size_t n) {
+  size_t added = 0;
+  for (size_t i = 0; i < n; ++i) {
+    added += add(pairs[i].first, pairs[i].second);
+  }
+  return added;
+}
+
+template <typename K, typename V>
+size_t tree_map<K, V>::merge(tree_map const & other) {
+  size_t added = 0;
+  other.for_each([&](K const & key, V const & value) { added += add(key, value); });
+  return added;
+}
+
 template <typename K, typename V>
 auto tree_map<K, V>::min(Node * node) const -> Node * {
-  if (!node) return nullptr;
-  if (!node->left) return node;
-  return min(node->left);
+  while (node && node->left) {
+    node = node->left;
+  }
+  return node;
+}
+
+template <typename K, typename V>
+K const * tree_map<K, V>::min_key() const {
+  Node * node = min(root_);
+  return node ? &node->key : nullptr;
 }
 
 template <typename K, typename V>
@@ -281,20 +490,6 @@ void tree_map<K, V>::trace() const {
   f << dot_graph(name);
 }
 
-template <typename K, typename V>
-auto tree_map<K, V>::delete_min(Node * node) -> Node * {
-  if (!node) return nullptr;
-  if (!node->left) {
-    Node * temp = node->right;
-    node->right = nullptr;
-    delete node;
-    return temp;
-  }
-  if (!is_red(node->left) && (!node->left || !is_red(node->left->left))) node = move_red_left(node);
-  node->left = delete_min(node->left);
-  return fix_up(node);
-}
-
 template <typename K, typename V>
 auto tree_map<K, V>::move_red_left(Node * node) -> Node * {
   node->flip_colors();
@@ -1,8 +1,13 @@
 #pragma once
 #include <stddef.h>
+#include <stdint.h>
 #include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
 #include <iostream>
 #include <memory>
+#include <utility>
 
 namespace gtl {
 
@@ -12,11 +17,14 @@ namespace gtl {
  * Allocates a contiguous buffer of `capacity` elements in memory. When capacity
  * is exceeded, a twice as large buffer is allocated, elements from the old
  * buffer are moved to the new buffer and the old buffer is deallocaed.
+ * Buffers are aligned for `T`, also for types aligned beyond what `new`
+ * guarantees (like cache line sized ones).
  */
 template <typename T> struct vector {
   vector();
   vector(vector const &other);
   vector(vector &&other);
+  vector(std::initializer_list<T> values);
   static vector reserve(size_t n);
 
   void swap(vector &other);
@@ -29,12 +37,28 @@ template <typename T> struct vector {
 
   void push_back(T const &value);
   void push_back(T &&value);
+  // Makes room for `n` more elements, at least doubling the buffer if it grows
+  void reserve_more(size_t n);
+  // Constructs the element in place, `args` may refer to elements of the vector
+  template <typename... Args> void emplace_back(Args &&... args);
+  // Copies `n` elements to the end, the buffer grows at most once
+  void append(T const * values, size_t n);
+  void append(vector const & other);
+  // Drops the elements after the first `n` or adds copies of `value` up to `n`
+  void resize(size_t n, T const & value = T());
   /*
    * O(1) remove operation, which swaps the element to be removed with the last
    * one and then pop_backs it. Changes the order of elements in the container.
    */
   void swap_remove(size_t index);
   T pop_back();
+  /*
+   * Removes the elements for which `pred(element)` is true in one pass,
+   * keeping the order of the rest. Returns the number of removed elements.
+   */
+  template <typename P> size_t erase_if(P pred);
+  // Reallocates the buffer to hold exactly `size()` elements
+  void shrink_to_fit();
 
   T const &operator[](size_t index) const;
   T &operator[](size_t index);
@@ -43,7 +67,13 @@ template <typename T> struct vector {
 
 private:
   vector(size_t n);
+  // Buffers of over-aligned types are over-allocated, with the offset of the
+  // elements in the byte before them
+  static T * allocate(size_t n);
+  static void deallocate(T * array);
   void reallocate();
+  // Moves the elements to a buffer of `capacity` elements
+  void reallocate(size_t capacity);
 
   size_t capacity_;
   T * array_;
@@ -63,7 +93,7 @@ vector<T>::vector(size_t n)
   , array_()
   , size_(0)
 {
-  array_ = reinterpret_cast<T*>(new char[capacity_*sizeof(T)]);
+  array_ = allocate(capacity_);
 }
 
 template <typename T>
@@ -72,12 +102,21 @@ vector<T>::vector(vector const & other)
   , array_()
   , size_(other.size_)
 {
-  array_ = reinterpret_cast<T *>(new char[capacity_*sizeof(T)]);
+  array_ = allocate(capacity_);
   for (size_t i = 0; i < size_; ++i) {
     new(reinterpret_cast<void *>(array_ + i)) T(other.array_[i]);
   }
 }
 
+template <typename T>
+vector<T>::vector(std::initializer_list<T> values)
+  : vector(values.size())
+{
+  for (T const & value : values) {
+    push_back(value);
+  }
+}
+
 template <typename T>
 void vector<T>::swap(vector &other) {
   std::swap(capacity_, other.capacity_);
@@ -112,7 +151,24 @@ vector<T>::~vector()
   for (size_t i = 0; i < size_; ++i) {
     array_[i].~T();
   }
-  delete[] reinterpret_cast<char *>(array_);
+  deallocate(array_);
+}
+
+template <typename T>
+T * vector<T>::allocate(size_t n) {
+  static_assert(alignof(T) < 256, "The offset of the elements has to fit a byte");
+  if (alignof(T) <= alignof(std::max_align_t)) return reinterpret_cast<T *>(new char[n*sizeof(T)]);
+  char * buffer = new char[n*sizeof(T) + alignof(T)];
+  size_t offset = alignof(T) - reinterpret_cast<uintptr_t>(buffer) % alignof(T);
+  buffer[offset - 1] = static_cast<char>(offset);
+  return reinterpret_cast<T *>(buffer + offset);
+}
+
+template <typename T>
+void vector<T>::deallocate(T * array) {
+  char * buffer = reinterpret_cast<char *>(array);
+  if (buffer && alignof(T) > alignof(std::max_align_t)) buffer -= static_cast<unsigned char>(buffer[-1]);
+  delete[] buffer;
 }
 
 template <typename T>
@@ -169,6 +225,97 @@ T vector<T>::pop_back() {
   return last_element;
 }
 
+template <typename T>
+void vector<T>::reallocate(size_t capacity) {
+  vector<T> temp;
+  if (capacity > 0) temp = vector<T>(capacity);
+  for (size_t i = 0; i < size_; ++i) {
+    temp.push_back(std::move(array_[i]));
+  }
+  swap(temp);
+}
+
+template <typename T>
+void vector<T>::reserve_more(size_t n) {
+  if (size_ + n > capacity_) reallocate(std::max(size_ + n, capacity_ * 2));
+}
+
+template <typename T>
+void vector<T>::shrink_to_fit() {
+  if (size_ != capacity_) reallocate(size_);
+}
+
+template <typename T>
+template <typename... Args>
+void vector<T>::emplace_back(Args &&... args) {
+  if (size_ < capacity_) {
+    new(reinterpret_cast<void *>(array_ + size_++)) T(std::forward<Args>(args)...);
+    return;
+  }
+  // The new element is constructed before the old ones move away from `args`
+  vector<T> temp(capacity_ > 0 ? capacity_ * 2 : 1);
+  new(reinterpret_cast<void *>(temp.array_ + size_)) T(std::forward<Args>(args)...);
+  for (size_t i = 0; i < size_; ++i) {
+    new(reinterpret_cast<void *>(temp.array_ + i)) T(std::move(array_[i]));
+  }
+  temp.size_ = size_ + 1;
+  swap(temp);
+}
+
+template <typename T>
+void vector<T>::append(T const * values, size_t n) {
+  assert((values + n <= array_ || values >= array_ + capacity_) && "Appending elements of the vector");
+  reserve_more(n);
+  for (size_t i = 0; i < n; ++i) {
+    new(reinterpret_cast<void *>(array_ + size_++)) T(values[i]);
+  }
+}
+
+template <typename T>
+void vector<T>::append(vector const & other) {
+  if (&other == this) {
+    vector<T> copy(other);
+    append(copy.array_, copy.size_);
+    return;
+  }
+  append(other.array_, other.size_);
+}
+
+template <typename T>
+void vector<T>::resize(size_t n, T const & value) {
+  while (size_ > n) {
+    array_[--size_].~T();
+  }
+  if (n > capacity_) {
+    // `value` may be an element of the vector
+    T copy(value);
+    reserve_more(n - size_);
+    while (size_ < n) {
+      new(reinterpret_cast<void *>(array_ + size_++)) T(copy);
+    }
+    return;
+  }
+  while (size_ < n) {
+    new(reinterpret_cast<void *>(array_ + size_++)) T(value);
+  }
+}
+
+template <typename T>
+template <typename P>
+size_t vector<T>::erase_if(P pred) {
+  size_t kept = 0;
+  for (size_t i = 0; i < size_; ++i) {
+    if (pred(static_cast<T const &>(array_[i]))) continue;
+    if (kept != i) array_[kept] = std::move(array_[i]);
+    ++kept;
+  }
+  size_t removed = size_ - kept;
+  while (size_ > kept) {
+    array_[--size_].~T();
+  }
+  return removed;
+}
+
 template <typename T>
 void vector<T>::swap_remove(size_t index) {
   assert(size_ != 0 && "Empty vector");
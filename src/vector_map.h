@@ -1,5 +1,6 @@
 #pragma once
 #include <stddef.h>
+#include <utility>
 #include "vector.h"
 
 namespace gtl {
@@ -23,6 +24,17 @@ template <typename K, typename V> struct vector_map {
 
   bool contains_key(K const &key) const;
 
+  // Calls `f(key, value)` for every element
+  template <typename F> void for_each(F f) const;
+
+  // Removes the elements for which `pred(key, value)` is true in one pass
+  // instead of a search per key, returns their number
+  template <typename P> size_t erase_if(P pred);
+  // Adds the `n` pairs like `add` in order, the buffer grows at most once
+  size_t insert(std::pair<K, V> const * pairs, size_t n);
+  // Adds every element of `other`, its values replace those of equal keys
+  size_t merge(vector_map const & other);
+
   void trace() const;
 private:
   size_t find(K const & key) const;
@@ -118,6 +130,40 @@ bool vector_map<K, V>::remove(K const &key) {
   return true;
 }
 
+template <typename K, typename V>
+template <typename F>
+void vector_map<K, V>::for_each(F f) const {
+  for (size_t i = 0; i < vector_.size(); ++i) {
+    f(vector_[i].key, vector_[i].value);
+  }
+}
+
+template <typename K, typename V>
+template <typename P>
+size_t vector_map<K, V>::erase_if(P pred) {
+  return vector_.erase_if([&pred](Entry const & entry) { return pred(entry.key, entry.value); });
+}
+
+template <typename K, typename V>
+size_t vector_map<K, V>::insert(std::pair<K, V> const * pairs, size_t n) {
+  vector_.reserve_more(n);
+  size_t added = 0;
+  for (size_t i = 0; i < n; ++i) {
+    added += add(pairs[i].first, pairs[i].second);
+  }
+  return added;
+}
+
+template <typename K, typename V>
+size_t vector_map<K, V>::merge(vector_map const & other) {
+  vector_.reserve_more(other.size());
+  size_t added = 0;
+  for (size_t i = 0; i < other.vector_.size(); ++i) {
+    added += add(other.vector_[i].key, other.vector_[i].value);
+  }
+  return added;
+}
+
 template <typename K, typename V>
 void vector_map<K, V>::trace() const {
   std::cout << "Capacity is " << vector_.capacity() << ", size is " << vector_.size() << std::endl;
@@ -0,0 +1,219 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include "vector.h"
+
+namespace gtl {
+
+/*
+ * Key streams for the map benchmarks. Everything is generated up front, so
+ * the timed loops only read keys from memory.
+ */
+enum key_distribution {
+  // Keys spread over the whole int range, accessed uniformly
+  UNIFORM,
+  // Same keys, accessed with a Zipfian skew: the k-th key is hit ~1/k^s times
+  ZIPFIAN,
+  // Keys 0..size-1, accessed in order
+  SEQUENTIAL,
+  // Multiples of a power of two, which share a factor with every capacity
+  // of a table indexed by `hash % capacity`
+  STRIDED,
+  // Runs of consecutive keys far apart, which the identity hash maps to runs
+  // of consecutive slots
+  CLUSTERED
+};
+
+struct workload_spec {
+  workload_spec()
+    : distribution(UNIFORM)
+    , size(10000)
+    , n_ops(100000)
+    , hit_ratio(0.5)
+    , zipf_s(0.99)
+    , stride(1024)
+    , cluster_size(64)
+    , seed(1)
+  {}
+
+  std::string name() const;
+
+  key_distribution distribution;
+  // Number of keys in the map
+  size_t size;
+  // Number of lookups and mixed operations
+  size_t n_ops;
+  // Share of the lookups for a key in the map
+  double hit_ratio;
+  double zipf_s;
+  size_t stride;
+  size_t cluster_size;
+  uint64_t seed;
+};
+
+inline std::string workload_spec::name() const {
+  std::stringstream s;
+  switch (distribution) {
+    case UNIFORM: s << "uniform"; break;
+    case ZIPFIAN: s << "zipf(" << zipf_s << ")"; break;
+    case SEQUENTIAL: s << "sequential"; break;
+    case STRIDED: s << "strided(" << stride << ")"; break;
+    case CLUSTERED: s << "clustered(" << cluster_size << ")"; break;
+  }
+  if (hit_ratio != 0.5) s << "/hit" << hit_ratio;
+  return s.str();
+}
+
+/*
+ * Ranks 0..n-1 with P(k) proportional to 1/(k+1)^s, in O(1) per draw
+ * (Gray et al., "Quickly generating billion-record synthetic databases",
+ * as used by YCSB). Construction is O(n). For s = 1 the draw is the limit
+ * of the formula, with the harmonic number H_n as the normalization.
+ */
+struct zipf_distribution {
+  zipf_distribution(size_t n, double s);
+
+  template <typename R> size_t operator() (R & rng) const;
+
+private:
+  size_t n_;
+  double zeta_n_;
+  // 0 for s = 1
+  double alpha_;
+  double eta_;
+  double second_;
+};
+
+inline zipf_distribution::zipf_distribution(size_t n, double s)
+  : n_(n)
+  , zeta_n_()
+  , alpha_(s == 1 ? 0 : 1 / (1 - s))
+  , eta_()
+  , second_(1 + std::pow(0.5, s))
+{
+  assert(n > 0 && s >= 0);
+  for (size_t i = 1; i <= n; ++i) {
+    zeta_n_ += 1 / std::pow((double)i, s);
+  }
+  double zeta_2 = 1 + std::pow(0.5, s);
+  if (n <= 2) return;
+  if (s == 1) {
+    eta_ = std::log(n / 2.0) / (1 - zeta_2 / zeta_n_);
+  } else {
+    eta_ = (1 - std::pow(2.0 / n, 1 - s)) / (1 - zeta_2 / zeta_n_);
+  }
+}
+
+template <typename R>
+size_t zipf_distribution::operator() (R & rng) const {
+  double u = std::uniform_real_distribution<double>(0, 1)(rng);
+  double uz = u * zeta_n_;
+  if (uz < 1 || n_ == 1) return 0;
+  if (uz < second_ || n_ == 2) return 1;
+  double scale = alpha_ == 0 ? std::exp(-eta_ * (1 - u)) : std::pow(eta_ * u - eta_ + 1, alpha_);
+  size_t rank = static_cast<size_t>(n_ * scale);
+  return std::min(rank, n_ - 1);
+}
+
+/*
+ * A benchmark input: the keys of the map and the streams of operations run
+ * against it
+ */
+struct workload {
+  enum op_kind { LOOKUP, ADD, REMOVE };
+  struct op {
+    op_kind kind;
+    int key;
+  };
+
+  explicit workload(workload_spec const & spec = workload_spec());
+
+  workload_spec spec;
+  // `spec.size` distinct keys, in insertion order
+  vector<int> keys;
+  // `spec.n_ops` lookups, `spec.hit_ratio` of them for a key in `keys`
+  vector<int> queries;
+  // Lookups, additions and removals 10:3:1, keys drawn as for `queries`
+  vector<op> ops;
+  // `keys` in random order
+  vector<int> removals;
+
+private:
+  int key_at(size_t i) const;
+  int query(size_t i, std::mt19937_64 & rng, zipf_distribution const & zipf) const;
+};
+
+// Key number `i`, keys `size..2*size-1` are the ones never added
+inline int workload::key_at(size_t i) const {
+  uint64_t key = 0;
+  switch (spec.distribution) {
+    case UNIFORM:
+    case ZIPFIAN:
+      // Multiplication by an odd number is a bijection modulo 2^31
+      key = (i * 2654435761ULL + spec.seed * 0x9e3779b97f4a7c15ULL) & 0x7fffffffULL;
+      break;
+    case SEQUENTIAL:
+      key = i;
+      break;
+    case STRIDED:
+      key = i * spec.stride;
+      break;
+    case CLUSTERED:
+      key = (i / spec.cluster_size) * (spec.cluster_size << 10) + i % spec.cluster_size;
+      break;
+  }
+  assert(key <= 0x7fffffffULL && "Key space of the workload is too large");
+  return static_cast<int>(key);
+}
+
+inline int workload::query(size_t i, std::mt19937_64 & rng, zipf_distribution const & zipf) const {
+  size_t n = spec.size;
+  bool hit = std::uniform_real_distribution<double>(0, 1)(rng) < spec.hit_ratio;
+  size_t index;
+  if (spec.distribution == SEQUENTIAL) {
+    index = i % n;
+  } else if (spec.distribution == ZIPFIAN && hit) {
+    index = zipf(rng);
+  } else {
+    index = std::uniform_int_distribution<size_t>(0, n - 1)(rng);
+  }
+  return key_at(hit ? index : n + index);
+}
+
+inline workload::workload(workload_spec const & spec)
+  : spec(spec)
+  , keys(vector<int>::reserve(spec.size))
+  , queries(vector<int>::reserve(spec.n_ops))
+  , ops(vector<op>::reserve(spec.n_ops))
+  , removals(vector<int>::reserve(spec.size))
+{
+  assert(spec.size > 0);
+  std::mt19937_64 rng(spec.seed);
+  // The exponent only matters, and is only checked, for Zipfian keys
+  zipf_distribution zipf = spec.distribution == ZIPFIAN ? zipf_distribution(spec.size, spec.zipf_s)
+                                                        : zipf_distribution(1, 0);
+  // Checks that the keys never added fit too
+  key_at(2 * spec.size - 1);
+
+  for (size_t i = 0; i < spec.size; ++i) {
+    keys.push_back(key_at(i));
+    removals.push_back(key_at(i));
+  }
+  std::shuffle(&removals[0], &removals[0] + removals.size(), rng);
+
+  for (size_t i = 0; i < spec.n_ops; ++i) {
+    queries.push_back(query(i, rng, zipf));
+  }
+  for (size_t i = 0; i < spec.n_ops; ++i) {
+    size_t kind = i % 14;
+    ops.push_back({kind < 10 ? LOOKUP : kind < 13 ? ADD : REMOVE, query(i, rng, zipf)});
+  }
+}
+
+}  // namespace gtl